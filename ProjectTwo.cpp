@@ -7,10 +7,54 @@
 
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <limits>
+#include <cctype>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <sstream>
+#include <csignal>
+#include <cerrno>
+#include <new>
+#include <type_traits>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <filesystem>
+
+// Every x86-64 processor has SSE2, so the csv scanner always uses it there.
+// AVX2 is compiled in separately and only used if the processor supports it.
+#if defined(__x86_64__) || defined(_M_X64)
+#define PLANNER_X86_64
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define PLANNER_AVX2
+#endif
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
 
 using namespace std;
 
@@ -18,9 +62,294 @@ using namespace std;
 // Global definitions visible to all methods and classes
 //============================================================================
 
+// The number of heap allocations made by the program so far. It is always defined,
+// but stays zero unless PLANNER_COUNT_ALLOCATIONS replaces the global allocation functions.
+atomic<size_t> allocationCount(0);
+
+#ifdef PLANNER_COUNT_ALLOCATIONS
+// The replacements are kept out of line where the compiler supports it, so that it never
+// sees malloc and free paired with new and delete at a call site.
+#if defined(__GNUC__) || defined(__clang__)
+#define PLANNER_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define PLANNER_NOINLINE __declspec(noinline)
+#else
+#define PLANNER_NOINLINE
+#endif
+
+// Count an allocation and make it, or return null if there is no memory.
+PLANNER_NOINLINE void* allocateCounted(size_t size) noexcept {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+
+    return malloc(size > 0 ? size : 1);
+}
+
+// Count an over-aligned allocation and make it, or return null if there is no memory.
+PLANNER_NOINLINE void* allocateCountedAligned(size_t size, align_val_t alignment) noexcept {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+
+    size = (size > 0) ? size : 1;
+
+#ifdef _WIN32
+    return _aligned_malloc(size, static_cast<size_t>(alignment));
+#else
+    void* memory = nullptr;
+
+    return (posix_memalign(&memory, static_cast<size_t>(alignment), size) == 0) ? memory : nullptr;
+#endif
+}
+
+// Free an over-aligned allocation.
+PLANNER_NOINLINE void freeAligned(void* memory) noexcept {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+// Count every allocation made through the global operator new and operator new[], in all of their forms.
+PLANNER_NOINLINE void* operator new(size_t size) {
+    if (void* memory = allocateCounted(size)) {
+        return memory;
+    }
+
+    throw bad_alloc();
+}
+
+PLANNER_NOINLINE void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+PLANNER_NOINLINE void* operator new(size_t size, const nothrow_t&) noexcept {
+    return allocateCounted(size);
+}
+
+PLANNER_NOINLINE void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return allocateCounted(size);
+}
+
+PLANNER_NOINLINE void* operator new(size_t size, align_val_t alignment) {
+    if (void* memory = allocateCountedAligned(size, alignment)) {
+        return memory;
+    }
+
+    throw bad_alloc();
+}
+
+PLANNER_NOINLINE void* operator new[](size_t size, align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+PLANNER_NOINLINE void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return allocateCountedAligned(size, alignment);
+}
+
+PLANNER_NOINLINE void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return allocateCountedAligned(size, alignment);
+}
+
+PLANNER_NOINLINE void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+PLANNER_NOINLINE void operator delete[](void* memory) noexcept {
+    free(memory);
+}
+
+PLANNER_NOINLINE void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+PLANNER_NOINLINE void operator delete[](void* memory, size_t) noexcept {
+    free(memory);
+}
+
+PLANNER_NOINLINE void operator delete(void* memory, const nothrow_t&) noexcept {
+    free(memory);
+}
+
+PLANNER_NOINLINE void operator delete[](void* memory, const nothrow_t&) noexcept {
+    free(memory);
+}
+
+PLANNER_NOINLINE void operator delete(void* memory, align_val_t) noexcept {
+    freeAligned(memory);
+}
+
+PLANNER_NOINLINE void operator delete[](void* memory, align_val_t) noexcept {
+    freeAligned(memory);
+}
+
+PLANNER_NOINLINE void operator delete(void* memory, size_t, align_val_t) noexcept {
+    freeAligned(memory);
+}
+
+PLANNER_NOINLINE void operator delete[](void* memory, size_t, align_val_t) noexcept {
+    freeAligned(memory);
+}
+
+PLANNER_NOINLINE void operator delete(void* memory, align_val_t, const nothrow_t&) noexcept {
+    freeAligned(memory);
+}
+
+PLANNER_NOINLINE void operator delete[](void* memory, align_val_t, const nothrow_t&) noexcept {
+    freeAligned(memory);
+}
+#endif
+
+#ifdef PLANNER_STATS
+// The phases of a load that are timed separately.
+enum LoadPhase { readPhase, parsePhase, checkPhase, insertPhase, indexPhase, snapshotPhase, loadPhaseCount };
+
+const char* const loadPhaseNames[loadPhaseCount] = { "Read", "Parse", "Check", "Insert", "Index", "Snapshot" };
+
+// Lookup latencies are counted in buckets of powers of two. Bucket b counts lookups of 2^b to 2^(b+1) - 1 nanoseconds.
+static constexpr size_t latencyBucketCount = 40;
+
+// Define a structure to hold the statistics collected while the program runs.
+// Statistics are only compiled in when PLANNER_STATS is defined.
+struct PlannerStats {
+    // The time and allocations spent in each phase of every load.
+    atomic<uint64_t> phaseNanoseconds[loadPhaseCount];
+    atomic<uint64_t> phaseAllocations[loadPhaseCount];
+
+    // The course lines and bytes parsed.
+    atomic<uint64_t> lines;
+    atomic<uint64_t> bytes;
+
+    // The depth of the tree's nodes and of the frozen index when the catalog was last frozen.
+    atomic<uint64_t> treeNodes;
+    atomic<uint64_t> treeMaxDepth;
+    atomic<uint64_t> treeDepthTotal;
+    atomic<uint64_t> indexSize;
+    atomic<uint64_t> indexMaxDepth;
+    atomic<uint64_t> indexDepthTotal;
+
+    // The number of lookups, the keys they compared and how long they took.
+    atomic<uint64_t> lookups;
+    atomic<uint64_t> lookupComparisons;
+    atomic<uint64_t> lookupLatencies[latencyBucketCount];
+
+    // The course lookups answered by the response cache, how many of those were for missing courses,
+    // the lookups that had to be rendered, and the entries evicted to make room.
+    atomic<uint64_t> cacheHits;
+    atomic<uint64_t> cacheNegativeHits;
+    atomic<uint64_t> cacheMisses;
+    atomic<uint64_t> cacheEvictions;
+};
+
+// The statistics are global, so every member starts at zero.
+PlannerStats plannerStats;
+
+// The keys compared by lookups on this thread so far.
+thread_local uint64_t threadComparisons = 0;
+
+// Define a class that adds the time and allocations of a phase to the statistics when it goes out of scope.
+// A phase started inside another pauses the outer one, so that time is only counted once.
+class PhaseTimer {
+
+private:
+    LoadPhase phase;
+    PhaseTimer* outerTimer;
+    chrono::steady_clock::time_point startTime;
+    size_t startAllocations;
+
+    // The innermost phase running on this thread.
+    static thread_local PhaseTimer* currentTimer;
+
+    void start() {
+        startTime = chrono::steady_clock::now();
+        startAllocations = allocationCount.load(memory_order_relaxed);
+    }
+
+    void stop() {
+        plannerStats.phaseNanoseconds[phase].fetch_add(static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - startTime).count()), memory_order_relaxed);
+        plannerStats.phaseAllocations[phase].fetch_add(allocationCount.load(memory_order_relaxed) - startAllocations,
+            memory_order_relaxed);
+    }
+
+public:
+    explicit PhaseTimer(LoadPhase timedPhase) : phase(timedPhase), outerTimer(currentTimer) {
+        if (outerTimer != nullptr) {
+            outerTimer->stop();
+        }
+
+        currentTimer = this;
+        start();
+    }
+
+    ~PhaseTimer() {
+        stop();
+        currentTimer = outerTimer;
+
+        if (outerTimer != nullptr) {
+            outerTimer->start();
+        }
+    }
+};
+
+thread_local PhaseTimer* PhaseTimer::currentTimer = nullptr;
+
+// Define a class that adds a lookup's latency and comparisons to the statistics when it goes out of scope.
+class LookupTimer {
+
+private:
+    chrono::steady_clock::time_point startTime;
+    uint64_t startComparisons;
+
+public:
+    LookupTimer() : startTime(chrono::steady_clock::now()), startComparisons(threadComparisons) {
+    }
+
+    ~LookupTimer() {
+        uint64_t nanoseconds = static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - startTime).count());
+        size_t bucket = 0;
+
+        while (bucket + 1 < latencyBucketCount && (nanoseconds >> (bucket + 1)) != 0) {
+            bucket++;
+        }
+
+        plannerStats.lookups.fetch_add(1, memory_order_relaxed);
+        plannerStats.lookupComparisons.fetch_add(threadComparisons - startComparisons, memory_order_relaxed);
+        plannerStats.lookupLatencies[bucket].fetch_add(1, memory_order_relaxed);
+    }
+};
+
+// Time a load phase until the end of the enclosing scope.
+#define PLANNER_STAT_PHASE(phase) PhaseTimer phaseTimer(phase)
+// Time a lookup until the end of the enclosing scope.
+#define PLANNER_STAT_LOOKUP() LookupTimer lookupTimer
+// Count a key compared by a lookup.
+#define PLANNER_STAT_COMPARISON() threadComparisons++
+// Add to a counter.
+#define PLANNER_STAT_ADD(counter, amount) plannerStats.counter.fetch_add(amount, memory_order_relaxed)
+#else
+// Without PLANNER_STATS, the statistics compile to nothing.
+#define PLANNER_STAT_PHASE(phase)
+#define PLANNER_STAT_LOOKUP()
+#define PLANNER_STAT_COMPARISON()
+#define PLANNER_STAT_ADD(counter, amount)
+#endif
+
 // Forward declarations.
-bool checkFileFormat(string csvPath, vector<string>& csvLines);
+struct ParsedCatalog;
+struct LoadOptions;
+struct PlanBuffers;
+class BinarySearchTree;
+class CatalogHandle;
+void parseCourses(char* data, size_t size, ParsedCatalog& catalog);
+void parseCoursesInParallel(char* data, size_t size, ParsedCatalog& catalog, unsigned threadCount);
+void joinParsedCatalogs(const vector<ParsedCatalog>& parts, ParsedCatalog& catalog, unsigned threadCount);
+bool checkFileFormat(ParsedCatalog& catalog, const LoadOptions& options);
+uint64_t updateChecksum(uint64_t checksum, const char* data, size_t size);
 string toUpperCase(string& str);
+string_view departmentOf(string_view courseNumber);
+bool isQueryLine(const string& line);
+bool answerQuery(const BinarySearchTree* tree, const string& line, PlanBuffers& planBuffers, ostream& out);
+bool publishCourses(CatalogHandle& catalogHandle, string csvPath, const LoadOptions& options, bool incremental);
 
 // Define a structure to hold course information.
 struct Course {
@@ -34,512 +363,9861 @@ struct Course {
         courseName = "";
         prerequisites.resize(0);
     }
+
+    // Initialize by taking ownership of each field.
+    Course(string&& aCourseNumber, string&& aCourseName, vector<string>&& aPrerequisites) :
+            courseNumber(std::move(aCourseNumber)),
+            courseName(std::move(aCourseName)),
+            prerequisites(std::move(aPrerequisites)) {
+    }
 };
 
-// Internal structure for a binary search tree node.
-struct Node {
-    Course course;
-    Node *left;
-    Node *right;
+// Define a structure to hold one course line parsed from a csv file.
+// The fields are views into the file's buffer, so nothing is copied while parsing.
+struct ParsedCourse {
+    string_view courseNumber;
+    string_view courseName;
+
+    // The range of this course's prerequisites in the parsed catalog's prerequisites vector.
+    uint32_t prerequisiteOffset;
+    uint32_t prerequisiteCount;
+};
+
+// Define a structure to hold every course line parsed from a csv file, in file order.
+struct ParsedCatalog {
+    vector<ParsedCourse> courses;
+
+    // The prerequisites of every course, back to back.
+    vector<string_view> prerequisites;
+
+    // The index of the course that each prerequisite names. This is filled in by checkFileFormat.
+    vector<uint32_t> prerequisiteCourses;
+};
+
+// Define a structure to hold the differences between the loaded courses and a parsed csv file.
+struct CatalogChanges {
+    // The indices of the parsed courses whose course numbers are not loaded.
+    vector<uint32_t> insertedCourses;
+
+    // The indices of the parsed courses whose names or prerequisites differ from the loaded course.
+    vector<uint32_t> updatedCourses;
+
+    // The course numbers of the loaded courses that are not in the csv file.
+    vector<string> removedCourses;
+
+    // The index of each inserted course by its course number.
+    unordered_map<string_view, uint32_t> insertedNumbers;
+
+    // Whether a course that did not change has a removed course as a prerequisite.
+    bool removedPrerequisite;
+
+    // Whether a course number appears more than once, so the courses must be loaded from scratch.
+    bool duplicateCourses;
 
     // Default constructor.
-    Node() {
-        left = nullptr;
-        right = nullptr;
+    CatalogChanges() {
+        removedPrerequisite = false;
+        duplicateCourses = false;
     }
+};
 
-    // Initialize with a course.
-    Node(Course aCourse) :
-            Node() {
-        course = aCourse;
+// Define a structure to hold a course number packed into two integers.
+//
+// The first 15 bytes of the upper-case course number are packed big-endian,
+// so comparing the two integers orders keys exactly like comparing the
+// strings. The last byte holds the length, or 0xFF when the course number
+// is too long to pack and the full strings must break a tie.
+// Course numbers never contain NUL bytes.
+struct CourseKey {
+    // The longest course number that fits entirely in a key.
+    static constexpr size_t maxPackedLength = 15;
+
+    uint64_t high;
+    uint64_t low;
+
+    // Default constructor.
+    CourseKey() {
+        high = 0;
+        low = 0;
+    }
+
+    // Initialize from an upper-case course number.
+    explicit CourseKey(string_view courseNumber) {
+        unsigned char bytes[16] = { 0 };
+        size_t length = courseNumber.size();
+
+        memcpy(bytes, courseNumber.data(), min(length, maxPackedLength));
+        bytes[15] = (length <= maxPackedLength) ? static_cast<unsigned char>(length) : 0xFF;
+
+        high = 0;
+        low = 0;
+
+        for (int i = 0; i < 8; i++) {
+            high = (high << 8) | bytes[i];
+            low = (low << 8) | bytes[8 + i];
+        }
+    }
+
+    // Whether the whole course number is in the key, so no string comparison is ever needed.
+    bool IsPacked() const {
+        return (low & 0xFF) != 0xFF;
+    }
+
+    bool operator==(const CourseKey& other) const {
+        return high == other.high && low == other.low;
+    }
+
+    bool operator<(const CourseKey& other) const {
+        return high < other.high || (high == other.high && low < other.low);
+    }
+
+    // Compare the packed integers. Returns a negative value, zero or a positive value like string::compare.
+    // Zero only means the course numbers are equal when the key IsPacked().
+    int Compare(const CourseKey& other) const {
+        if (high != other.high) {
+            return (high < other.high) ? -1 : 1;
+        }
+
+        if (low != other.low) {
+            return (low < other.low) ? -1 : 1;
+        }
+
+        return 0;
     }
 };
 
-//============================================================================
-// Binary Search Tree class definition
-//============================================================================
+// Define a structure to hold the options used when loading courses.
+struct LoadOptions {
+    // Whether prerequisites may refer to courses on later lines of the file.
+    // Deferred prerequisites are resolved in one batch after every course number is known.
+    // When false, each prerequisite must name a course from an earlier line.
+    bool deferPrerequisites;
 
-/**
- * Define a class containing data members and methods to
- * implement a binary search tree.
- */
-class BinarySearchTree {
+    // The number of threads used to parse the file and build the index.
+    unsigned threadCount;
 
-private:
-    Node* node;
+    // The snapshot file to open instead of the csv file when it is up to date, and to write after a load otherwise.
+    string snapshotPath;
 
-    void deleteNode(Node* node);
-    void addNode(Node* node, Course course);
-    void printSampleSchedule(Node* node);
-    void printCourseInformation(string courseNumber);
+    // Whether a full load reads the csv file in fixed-size blocks and adds each course to the catalog as it is parsed,
+    // instead of mapping the whole file and parsing it first. The courses get no tree nodes: the frozen index is built
+    // from the catalog. It uses one thread. Reloads still read the whole file.
+    bool streaming;
 
-public:
-    BinarySearchTree();
-    virtual ~BinarySearchTree();
-    void Clear();
-    void Insert(Course course);
-    void PrintSampleSchedule();
-    void PrintCourseInformation(string courseNumber);
+    // The most rendered course details that a loaded tree keeps for repeated lookups. Zero disables the cache.
+    size_t responseCacheSize;
+
+    // Default constructor.
+    LoadOptions() {
+        deferPrerequisites = true;
+        threadCount = 1;
+        streaming = false;
+        responseCacheSize = 4096;
+    }
+
+    // The options that change which csv files are accepted, recorded in snapshot files.
+    uint32_t SnapshotFlags() const {
+        return deferPrerequisites ? 1 : 0;
+    }
 };
 
-//============================================================================
-// BinarySearchTree private method definitions.
-//============================================================================
+// Define a structure to hold the options for generating a synthetic catalog.
+// The same options always generate the same file, on any platform.
+struct GeneratorOptions {
+    // The number of courses.
+    size_t courseCount;
 
-/**
- * Recursively delete all nodes in the BST.
- * 
- * @param curNode - This is the current node in the deletion process.
- */
-void BinarySearchTree::deleteNode(Node* currentNode) {
-    // If the current node is not null...
-    if (currentNode != nullptr) {
-        // If the current node has no children...
-        if ((currentNode->left == nullptr) && (currentNode->right == nullptr)) {
-            // Delete the current node from the BST.
-            delete currentNode;
-            currentNode = nullptr;
-        }
-        // If the current node has any children...
-        else {
-            // Recursively delete the left node.
-            deleteNode(currentNode->left);
+    // The most prerequisites of each course. Prerequisites always sort before their course, so there are no cycles.
+    size_t fanOut;
 
-            // Recursively delete the right node.
-            deleteNode(currentNode->right);
-        }
+    // The order of the lines: "sorted" by course number, "shuffled", or "adversarial".
+    // Adversarial lines alternate between the smallest and largest remaining course numbers, which
+    // share a prefix longer than a packed key, so every insertion rebalances and every comparison reads the text.
+    string order;
+
+    // The number of characters in each course name.
+    size_t nameLength;
+
+    // The seed of the random number generator.
+    uint64_t seed;
+
+    // Default constructor.
+    GeneratorOptions() {
+        courseCount = 1000;
+        fanOut = 3;
+        order = "shuffled";
+        nameLength = 32;
+        seed = 1;
     }
-}
+};
 
 /**
- * Add a course to some node (recursive).
+ * Run a number of tasks at the same time, one per thread, and wait for all of them.
+ * The calling thread runs the first task itself.
  *
- * @param node - Current node in tree.
- * @param course - Course to be added.
+ * @param taskCount - The number of tasks.
+ * @param task - A callable that takes the index of its task.
  */
-void BinarySearchTree::addNode(Node* node, Course course) {
-    // If the current node's course number is greater than the specified course's course number...
-    if (node->course.courseNumber > course.courseNumber) {
-        // If the current node does not have a left child...
-        if (node->left == nullptr) {
-            // Set the left child to a new course node containing the specified course.
-            node->left = new Node(course);
-        }
-        // If the current node has a left child...
-        else {
-            // Recursively traverse down the left sub-tree.
-            addNode(node->left, course);
-        }
+template <typename Task>
+void runInParallel(size_t taskCount, Task task) {
+    vector<thread> threads;
+
+    for (size_t i = 1; i < taskCount; i++) {
+        threads.emplace_back(task, i);
     }
-    // If the current node's course number is less than or equal to the specified course's course number...
-    else {
-        // If the current node does not have a right child...
-        if (node->right == nullptr) {
-            // Set the right child to a new course node containing the specified course.
-            node->right = new Node(course);
-        }
-        // If the current node has a right child...
-        else {
-            // Recursively traverse down the right sub-tree.
-            addNode(node->right, course);
-        }
+
+    if (taskCount > 0) {
+        task(0);
+    }
+
+    for (thread& worker : threads) {
+        worker.join();
     }
 }
 
 /**
-* Recursively traverse the BST in order and print each node.
-* 
-* @param node - The current node in the BST.
-*/
-void BinarySearchTree::printSampleSchedule(Node* node) {
-    // If the current node is not null...
-    if (node != nullptr) {
-        // Recursively print out the left sub-tree.
-        printSampleSchedule(node->left);
+ * Sort a vector by sorting equal parts on separate threads and then merging
+ * neighbouring parts in parallel rounds.
+ *
+ * @param items - The vector to sort.
+ * @param isLess - The comparison that orders the items.
+ * @param threadCount - The number of threads to use.
+ */
+template <typename Item, typename Compare>
+void parallelSort(vector<Item>& items, Compare isLess, unsigned threadCount) {
+    size_t size = items.size();
 
-        // Print the node's course number and course name.
-        std::cout << node->course.courseNumber << ", "
-            << node->course.courseName << endl;
+    // Small inputs are not worth starting threads for.
+    if (threadCount <= 1 || size < 65536) {
+        sort(items.begin(), items.end(), isLess);
 
-        // Recursively print out the right sub-tree.
-        printSampleSchedule(node->right);
+        return;
     }
-}
 
-void BinarySearchTree::printCourseInformation(string courseNumber) {
-    // Set the current node to the root.
-    Node* currentNode = node;
+    size_t partCount = threadCount;
+    vector<size_t> bounds(partCount + 1);
 
-    // Boolean to determine if the course was found.
-    bool courseFound = false;
+    for (size_t i = 0; i <= partCount; i++) {
+        bounds[i] = size * i / partCount;
+    }
 
-    // Keep looping downwards until the bottom of the tree is reached or a matching course number is found.
-    while (currentNode != nullptr) {
-        // If the current node's course contains the specified courseNumber...
-        if (currentNode->course.courseNumber == courseNumber) {
-            // Update the courseFound boolean since it was found.
-            courseFound = true;
-
-            // Print the node's course number and course name.
-            cout << currentNode->course.courseNumber << ", "
-                 << currentNode->course.courseName << endl;
-
-            // Get the amount of prerequisites the current course has.
-            int prerequisitesSize = currentNode->course.prerequisites.size();
-
-            // Prerequisite identifier string.
-            cout << "Prerequisites: ";
-
-            // If the course has any prerequisites...
-            if (prerequisitesSize > 0) {
-                // Print each prerequisite course number.
-                for (int i = 0; i < prerequisitesSize; i++) {
-                    // If the current prerequisite is not the last one in the prerequisites vector...
-                    if (i < prerequisitesSize - 1) {
-                        // Print the course number followed by a comma.
-                        cout << currentNode->course.prerequisites.at(i) << ", ";
-                    }
-                    // If it is the last or only element in the prerequisites vector...
-                    else {
-                        // Print the course number followed by a new line.
-                        cout << currentNode->course.prerequisites.at(i) << endl;
-                    }
-                }
-            }
-            else {
-                // Print a message to show that the course has no prerequities.
-                cout << "None" << endl;
-            }
+    // Sort each part on its own thread.
+    runInParallel(partCount, [&](size_t part) {
+        sort(items.begin() + bounds[part], items.begin() + bounds[part + 1], isLess);
+    });
 
-            // Stop searching after the course is found.
-            break;
-        }
-        // If the specified course number is smaller than the course number at the current node...
-        else if (courseNumber < currentNode->course.courseNumber) {
-            // Traverse the left sub-tree.
-            currentNode = currentNode->left;
-        }
-        // If the specified course number is larger than the course number at the current node...
-        else {
-            // Traverse the right sub-tree.
-            currentNode = currentNode->right;
-        }
-    }
+    vector<Item> merged(size);
 
-    // If the specified course was not found...
-    if (!courseFound) {
-        // Print a message to show that the course was not found.
-        cout << "Course not found." << endl;
+    // Merge pairs of sorted runs, doubling the run length each round.
+    for (size_t width = 1; width < partCount; width *= 2) {
+        size_t groupCount = (partCount + 2 * width - 1) / (2 * width);
+
+        runInParallel(groupCount, [&](size_t group) {
+            size_t first = bounds[group * 2 * width];
+            size_t middle = bounds[min(group * 2 * width + width, partCount)];
+            size_t last = bounds[min(group * 2 * width + 2 * width, partCount)];
+
+            merge(items.begin() + first, items.begin() + middle,
+                items.begin() + middle, items.begin() + last,
+                merged.begin() + first, isLess);
+        });
+
+        items.swap(merged);
     }
 }
 
+// Internal structure for a binary search tree node.
+// The course itself lives in the tree's CourseCatalog and is referred to by its ID.
+struct Node {
+    CourseKey key;
+    Node *left;
+    Node *right;
+    uint32_t courseId;
+
+    // The height of the sub-tree rooted at this node. A leaf has a height of 1.
+    int height;
+
+    // Default constructor.
+    Node() {
+        courseId = 0;
+        left = nullptr;
+        right = nullptr;
+        height = 1;
+    }
+
+    // Initialize with a course's key and ID.
+    Node(const CourseKey& aKey, uint32_t aCourseId) :
+            Node() {
+        key = aKey;
+        courseId = aCourseId;
+    }
+};
+
 //============================================================================
-// BinarySearchTree public method definitions.
+// Node Pool class definition
 //============================================================================
 
+/**
+ * Define a class that allocates binary search tree nodes from large slabs
+ * instead of calling new for every node.
+ *
+ * Nodes released one at a time are kept on a free list and reused by the
+ * next allocations. Clear() destroys every node with one linear sweep over
+ * the slabs and returns the slabs to the system, so no node can be leaked
+ * however the tree was shaped.
+ */
+class NodePool {
+
+private:
+    // The number of nodes in the first slab. Each new slab doubles in size up to the maximum.
+    static constexpr size_t firstSlabSize = 256;
+    static constexpr size_t maxSlabSize = 65536;
+
+    // Define a structure to hold one block of node storage.
+    struct Slab {
+        Node* nodes;
+        size_t capacity;
+    };
+
+    vector<Slab> slabs;
+
+    // The number of nodes constructed in the last slab.
+    size_t usedInLastSlab;
+
+    // The released nodes, linked through their left pointers. They stay constructed until Clear().
+    Node* freeNodes;
+
+    void addSlab();
+
+public:
+    NodePool();
+    virtual ~NodePool();
+    Node* Allocate(const CourseKey& key, uint32_t courseId);
+    void Release(Node* node);
+    void Clear();
+};
+
 /**
  * Default constructor
  */
-BinarySearchTree::BinarySearchTree() {
-    // The root node is initially null.
-    node = nullptr;
+NodePool::NodePool() {
+    usedInLastSlab = 0;
+    freeNodes = nullptr;
 }
 
 /**
  * Destructor
  */
-BinarySearchTree::~BinarySearchTree() {
-    // Recursively delete each node in the BST, starting at the root.
-    deleteNode(node);
+NodePool::~NodePool() {
+    Clear();
 }
 
 /**
- * Remove all elements from the BST.
+ * Add a new slab of uninitialized node storage.
  */
-void BinarySearchTree::Clear() {
-    // Recursively delete each node in the BST, starting at the root.
-    deleteNode(node);
+void NodePool::addSlab() {
+    size_t capacity = slabs.empty() ? firstSlabSize : min(slabs.back().capacity * 2, maxSlabSize);
 
-    // Reinitialize the root node after deleting all nodes from the BST.
-    node = nullptr;
+    // Allocate raw storage. The nodes are constructed in place as they are handed out.
+    Node* nodes = static_cast<Node*>(::operator new(capacity * sizeof(Node)));
+
+    slabs.push_back({ nodes, capacity });
+    usedInLastSlab = 0;
 }
 
 /**
- * Insert a course into the BST.
+ * Construct a node in the pool.
+ *
+ * @param key - The packed course number of the node's course.
+ * @param courseId - The ID of the node's course in the tree's catalog.
+ * @return The new node.
+ */
+Node* NodePool::Allocate(const CourseKey& key, uint32_t courseId) {
+    // Reuse a released node first.
+    if (freeNodes != nullptr) {
+        Node* node = freeNodes;
+
+        freeNodes = node->left;
+        *node = Node(key, courseId);
+
+        return node;
+    }
+
+    // If the last slab is full (or there are no slabs yet)...
+    if (slabs.empty() || usedInLastSlab == slabs.back().capacity) {
+        addSlab();
+    }
+
+    Node* node = &slabs.back().nodes[usedInLastSlab];
+
+    // Construct the node in the slab's storage.
+    new (node) Node(key, courseId);
+    usedInLastSlab++;
+
+    return node;
+}
+
+/**
+ * Return a node that is no longer in the tree to the pool.
+ *
+ * @param node - The node to release. It must have been allocated by this pool.
+ */
+void NodePool::Release(Node* node) {
+    node->left = freeNodes;
+    freeNodes = node;
+}
+
+/**
+ * Destroy every node in the pool and release all of its memory.
+ */
+void NodePool::Clear() {
+    for (size_t i = 0; i < slabs.size(); i++) {
+        // Every slab except the last one is full.
+        size_t used = (i + 1 == slabs.size()) ? usedInLastSlab : slabs[i].capacity;
+
+        // Nodes that own no memory do not need their destructors run.
+        if (!is_trivially_destructible<Node>::value) {
+            for (size_t j = 0; j < used; j++) {
+                slabs[i].nodes[j].~Node();
+            }
+        }
+
+        ::operator delete(slabs[i].nodes);
+    }
+
+    slabs.clear();
+    usedInLastSlab = 0;
+    freeNodes = nullptr;
+}
+
+//============================================================================
+// Course Catalog class definition
+//============================================================================
+
+/**
+ * Define a class that stores every course in a catalog by a dense integer ID.
+ *
+ * Course numbers are interned: each distinct course number is stored once
+ * and found through an open-addressing hash table of IDs. Numbers and names
+ * are packed back to back in one text buffer. Prerequisites are stored as
+ * IDs in one flat array shared by the whole catalog, and each course refers
+ * to its contiguous range of that array (compressed sparse row), so a
+ * prerequisite costs four bytes instead of its own string.
+ *
+ * A course number that is referred to before its own line is read gets a
+ * placeholder ID, which is filled in when the course is defined.
+ *
+ * A catalog can also be attached to arrays stored elsewhere, such as a
+ * mapped snapshot file, and read without copying them. Its arrays are
+ * copied into the catalog's own storage the first time it is changed.
+ *
+ * Updating or removing a course leaves its old text and prerequisite IDs
+ * unused, and a removed course keeps its ID. Compact() copies out only
+ * what is still used once ShouldCompact() finds too much is not.
+ */
+class CourseCatalog {
+
+public:
+    // The ID returned when there is no such course.
+    static constexpr uint32_t noCourse = UINT32_MAX;
+
+    // Define a structure to hold a contiguous range of course IDs.
+    struct IdRange {
+        const uint32_t* first;
+        const uint32_t* last;
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+    // Define a structure to hold the location of every array in a catalog.
+    // The entries are opaque records of EntrySize() bytes each.
+    struct Arrays {
+        const void* entries;
+        size_t entryCount;
+        const char* text;
+        size_t textSize;
+        const uint32_t* prerequisiteIds;
+        size_t prerequisiteCount;
+        const uint32_t* slots;
+        size_t slotCount;
+    };
+
+private:
+    // The prerequisite offset of a course that has been referred to but not defined yet.
+    static constexpr uint32_t placeholderOffset = UINT32_MAX;
+
+    // Compact once more than this fraction (1 / compactionShare) of the catalog's bytes are unused.
+    static constexpr size_t compactionShare = 4;
+
+    // Define a structure to hold where a course's fields are stored.
+    struct Entry {
+        // The course number, immediately followed by the course name, in the text buffer.
+        uint64_t textOffset;
+        uint32_t numberLength;
+        uint32_t nameLength;
+
+        // The course's range of the prerequisite IDs array.
+        uint32_t prerequisiteOffset;
+        uint32_t prerequisiteCount;
+    };
+
+    vector<Entry> entries;
+    vector<char> text;
+    vector<uint32_t> prerequisiteIds;
+
+    // The hash table of interned IDs. Empty slots hold noCourse.
+    vector<uint32_t> slots;
+    size_t internedCount;
+
+    // The bytes of text and prerequisite IDs that no course uses any more.
+    size_t unusedBytes;
+
+    // The arrays that are read instead of the vectors while the catalog is attached.
+    Arrays attachedArrays;
+    bool attached;
+
+    static uint64_t hashNumber(string_view courseNumber);
+
+    const Entry& entryAt(uint32_t id) const;
+    const char* textData() const;
+    void detach();
+    size_t countUnusedBytes() const;
+
+    uint32_t addEntry(string_view courseNumber, string_view courseName);
+    void addSlot(uint32_t id);
+    void resizeSlots(size_t slotCount);
+
+public:
+    CourseCatalog();
+    void Clear();
+    void Reserve(size_t courseCount, size_t textSize, size_t prerequisiteCount);
+    uint32_t Intern(string_view courseNumber);
+    uint32_t Define(string_view courseNumber, string_view courseName, const uint32_t* prerequisites, size_t prerequisiteCount);
+    void Update(uint32_t id, string_view courseName, const uint32_t* prerequisites, size_t prerequisiteCount);
+    void Remove(uint32_t id);
+    bool ShouldCompact() const;
+    void Compact(vector<uint32_t>& newIds);
+    uint32_t Find(string_view courseNumber) const;
+    bool IsDefined(uint32_t id) const;
+    size_t Size() const;
+    string_view Number(uint32_t id) const;
+    string_view Name(uint32_t id) const;
+    IdRange Prerequisites(uint32_t id) const;
+    static size_t EntrySize();
+    static bool CheckArrays(const Arrays& arrays);
+    Arrays GetArrays() const;
+    void Attach(const Arrays& arrays);
+    void Assign(const Arrays& arrays);
+};
+
+/**
+ * Default constructor
+ */
+CourseCatalog::CourseCatalog() {
+    internedCount = 0;
+    unusedBytes = 0;
+    attachedArrays = Arrays();
+    attached = false;
+}
+
+/**
+ * Hash a course number with 64-bit FNV-1a.
+ *
+ * @param courseNumber - The course number to hash.
+ */
+uint64_t CourseCatalog::hashNumber(string_view courseNumber) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (char c : courseNumber) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * Get a course's entry from the attached arrays or the catalog's own storage.
+ *
+ * @param id - The course's ID.
+ */
+const CourseCatalog::Entry& CourseCatalog::entryAt(uint32_t id) const {
+    if (attached) {
+        return static_cast<const Entry*>(attachedArrays.entries)[id];
+    }
+
+    return entries[id];
+}
+
+/**
+ * Get the first byte of the text buffer from the attached arrays or the catalog's own storage.
+ */
+const char* CourseCatalog::textData() const {
+    return attached ? attachedArrays.text : text.data();
+}
+
+/**
+ * Copy the attached arrays into the catalog's own storage so that it can be changed.
+ */
+void CourseCatalog::detach() {
+    if (!attached) {
+        return;
+    }
+
+    const Entry* firstEntry = static_cast<const Entry*>(attachedArrays.entries);
+
+    entries.assign(firstEntry, firstEntry + attachedArrays.entryCount);
+    text.assign(attachedArrays.text, attachedArrays.text + attachedArrays.textSize);
+    prerequisiteIds.assign(attachedArrays.prerequisiteIds, attachedArrays.prerequisiteIds + attachedArrays.prerequisiteCount);
+    slots.assign(attachedArrays.slots, attachedArrays.slots + attachedArrays.slotCount);
+
+    // Every slot that is in use holds one interned ID.
+    internedCount = static_cast<size_t>(count_if(slots.begin(), slots.end(), [](uint32_t id) {
+        return id != noCourse;
+    }));
+
+    // The arrays do not record what is unused, so count it.
+    unusedBytes = countUnusedBytes();
+
+    attachedArrays = Arrays();
+    attached = false;
+}
+
+/**
+ * Count the bytes of the catalog's own text and prerequisite IDs that no course's range covers.
+ */
+size_t CourseCatalog::countUnusedBytes() const {
+    size_t usedText = 0;
+    size_t usedPrerequisites = 0;
+
+    for (const Entry& entry : entries) {
+        usedText += entry.numberLength + entry.nameLength;
+        usedPrerequisites += entry.prerequisiteCount;
+    }
+
+    // Ranges never overlap in a catalog that this class built, but arrays read from elsewhere might.
+    size_t unusedText = (usedText < text.size()) ? text.size() - usedText : 0;
+    size_t unusedPrerequisites = (usedPrerequisites < prerequisiteIds.size()) ? prerequisiteIds.size() - usedPrerequisites : 0;
+
+    return unusedText + unusedPrerequisites * sizeof(uint32_t);
+}
+
+/**
+ * Append a new course's text to the catalog. It has no prerequisite range yet.
+ *
+ * @param courseNumber - The course's number.
+ * @param courseName - The course's name, or an empty name for a placeholder.
+ * @return The new course's ID.
+ */
+uint32_t CourseCatalog::addEntry(string_view courseNumber, string_view courseName) {
+    Entry entry;
+
+    entry.textOffset = text.size();
+    entry.numberLength = static_cast<uint32_t>(courseNumber.size());
+    entry.nameLength = static_cast<uint32_t>(courseName.size());
+    entry.prerequisiteOffset = placeholderOffset;
+    entry.prerequisiteCount = 0;
+
+    text.insert(text.end(), courseNumber.begin(), courseNumber.end());
+    text.insert(text.end(), courseName.begin(), courseName.end());
+
+    entries.push_back(entry);
+
+    return static_cast<uint32_t>(entries.size() - 1);
+}
+
+/**
+ * Add an ID to the hash table under its course number.
+ *
+ * @param id - The ID to add.
+ */
+void CourseCatalog::addSlot(uint32_t id) {
+    // Keep the table at most half full so that probes stay short.
+    if ((internedCount + 1) * 2 > slots.size()) {
+        resizeSlots(max<size_t>(slots.size() * 2, 16));
+    }
+
+    size_t mask = slots.size() - 1;
+    size_t slot = hashNumber(Number(id)) & mask;
+
+    // Probe linearly for an empty slot.
+    while (slots[slot] != noCourse) {
+        slot = (slot + 1) & mask;
+    }
+
+    slots[slot] = id;
+    internedCount++;
+}
+
+/**
+ * Resize the hash table and re-add every interned ID.
+ *
+ * @param slotCount - The new number of slots. It must be a power of two.
+ */
+void CourseCatalog::resizeSlots(size_t slotCount) {
+    vector<uint32_t> oldSlots(slotCount, noCourse);
+
+    oldSlots.swap(slots);
+    internedCount = 0;
+
+    for (uint32_t id : oldSlots) {
+        if (id != noCourse) {
+            addSlot(id);
+        }
+    }
+}
+
+/**
+ * Remove every course from the catalog and release its memory.
+ */
+void CourseCatalog::Clear() {
+    vector<Entry>().swap(entries);
+    vector<char>().swap(text);
+    vector<uint32_t>().swap(prerequisiteIds);
+    vector<uint32_t>().swap(slots);
+    internedCount = 0;
+    unusedBytes = 0;
+
+    // Stop reading any attached arrays. Their owner releases them.
+    attachedArrays = Arrays();
+    attached = false;
+}
+
+/**
+ * Reserve space for a known number of courses so that a bulk load does not reallocate.
+ *
+ * @param courseCount - The number of courses.
+ * @param textSize - The total length of every course number and name.
+ * @param prerequisiteCount - The total number of prerequisites.
+ */
+void CourseCatalog::Reserve(size_t courseCount, size_t textSize, size_t prerequisiteCount) {
+    detach();
+
+    entries.reserve(courseCount);
+    text.reserve(textSize);
+    prerequisiteIds.reserve(prerequisiteCount);
+
+    // Size the hash table once for every course.
+    size_t slotCount = 16;
+
+    while (slotCount < courseCount * 2) {
+        slotCount *= 2;
+    }
+
+    if (slotCount > slots.size()) {
+        resizeSlots(slotCount);
+    }
+}
+
+/**
+ * Get the ID of a course number, adding a placeholder course if it is new.
+ *
+ * @param courseNumber - The upper-case course number.
+ * @return The course number's ID.
+ */
+uint32_t CourseCatalog::Intern(string_view courseNumber) {
+    detach();
+
+    uint32_t id = Find(courseNumber);
+
+    if (id == noCourse) {
+        id = addEntry(courseNumber, string_view());
+        addSlot(id);
+    }
+
+    return id;
+}
+
+/**
+ * Define a course. A placeholder with the same course number is filled in.
+ * A course number that is already defined gets a second, separate course,
+ * but lookups by course number still find the first one.
+ *
+ * @param courseNumber - The upper-case course number.
+ * @param courseName - The course name.
+ * @param prerequisites - The IDs of the course's prerequisites.
+ * @param prerequisiteCount - The number of prerequisites.
+ * @return The course's ID.
  */
-void BinarySearchTree::Insert(Course course) {
-    // If the BST is empty...
-    if (node == nullptr) {
-        // Initialize the root node with the given course.
-        node = new Node(course);
+uint32_t CourseCatalog::Define(string_view courseNumber, string_view courseName,
+        const uint32_t* prerequisites, size_t prerequisiteCount) {
+    detach();
+
+    uint32_t id = Find(courseNumber);
+
+    // If the course number is new...
+    if (id == noCourse) {
+        id = addEntry(courseNumber, courseName);
+        addSlot(id);
+    }
+    // If the course number is already defined...
+    else if (IsDefined(id)) {
+        id = addEntry(courseNumber, courseName);
     }
+    // If the course number was only a placeholder, store its number again next to its name.
     else {
-        // Add a node with the given course into the correct place in the BST.
-        addNode(node, course);
+        Entry& entry = entries[id];
+
+        unusedBytes += entry.numberLength;
+        entry.textOffset = text.size();
+        entry.nameLength = static_cast<uint32_t>(courseName.size());
+
+        text.insert(text.end(), courseNumber.begin(), courseNumber.end());
+        text.insert(text.end(), courseName.begin(), courseName.end());
     }
+
+    Entry& entry = entries[id];
+
+    entry.prerequisiteOffset = static_cast<uint32_t>(prerequisiteIds.size());
+    entry.prerequisiteCount = static_cast<uint32_t>(prerequisiteCount);
+
+    prerequisiteIds.insert(prerequisiteIds.end(), prerequisites, prerequisites + prerequisiteCount);
+
+    return id;
 }
 
 /**
- * Print each course in ascending alphanumeric order.
+ * Replace a defined course's name and prerequisites. The course keeps its
+ * ID, so every reference to it stays valid. The old fields are left unused
+ * in the catalog's arrays until it is compacted.
+ *
+ * @param id - The course's ID.
+ * @param courseName - The new course name. It must not refer to the catalog's own text.
+ * @param prerequisites - The IDs of the new prerequisites. They must not refer to the catalog's own arrays.
+ * @param prerequisiteCount - The number of prerequisites.
  */
-void BinarySearchTree::PrintSampleSchedule() {
-    // Call the private method to display all courses from the BST in order.
-    printSampleSchedule(node);
+void CourseCatalog::Update(uint32_t id, string_view courseName, const uint32_t* prerequisites, size_t prerequisiteCount) {
+    detach();
+
+    Entry& entry = entries[id];
+    size_t newOffset = text.size();
+
+    unusedBytes += entry.numberLength + entry.nameLength + entry.prerequisiteCount * sizeof(uint32_t);
+
+    // Copy the course number next to the new name, since the name must follow the number.
+    text.resize(newOffset + entry.numberLength + courseName.size());
+    memcpy(text.data() + newOffset, text.data() + entry.textOffset, entry.numberLength);
+    memcpy(text.data() + newOffset + entry.numberLength, courseName.data(), courseName.size());
+
+    entry.textOffset = newOffset;
+    entry.nameLength = static_cast<uint32_t>(courseName.size());
+    entry.prerequisiteOffset = static_cast<uint32_t>(prerequisiteIds.size());
+    entry.prerequisiteCount = static_cast<uint32_t>(prerequisiteCount);
+
+    prerequisiteIds.insert(prerequisiteIds.end(), prerequisites, prerequisites + prerequisiteCount);
 }
 
 /**
- * Search for and print a specified course.
- * 
- * @param courseNumber - The number of the course to print.
+ * Remove a course, so that its course number is no longer found. The ID is
+ * not reused, and a later course with the same number gets a new ID. The
+ * ID is left as a placeholder, without a name, until the catalog is
+ * compacted, since other courses may still list it as a prerequisite.
+ *
+ * @param id - The course's ID.
+ */
+void CourseCatalog::Remove(uint32_t id) {
+    detach();
+
+    Entry& entry = entries[id];
+
+    unusedBytes += entry.nameLength + entry.prerequisiteCount * sizeof(uint32_t);
+    entry.nameLength = 0;
+    entry.prerequisiteOffset = placeholderOffset;
+    entry.prerequisiteCount = 0;
+
+    if (slots.empty()) {
+        return;
+    }
+
+    size_t mask = slots.size() - 1;
+    size_t hole = hashNumber(Number(id)) & mask;
+
+    // Find the ID's slot. A second course with the same number was never added to the table.
+    while (slots[hole] != id) {
+        if (slots[hole] == noCourse) {
+            return;
+        }
+
+        hole = (hole + 1) & mask;
+    }
+
+    // Shift the rest of the probe run back over the hole, so that no probe stops early.
+    for (size_t slot = (hole + 1) & mask; slots[slot] != noCourse; slot = (slot + 1) & mask) {
+        size_t home = hashNumber(Number(slots[slot])) & mask;
+
+        // An ID can move back to the hole unless its home slot lies after the hole.
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            slots[hole] = slots[slot];
+            hole = slot;
+        }
+    }
+
+    slots[hole] = noCourse;
+    internedCount--;
+}
+
+/**
+ * Determine whether enough of the catalog is unused to be worth compacting.
+ * Attached arrays are never compacted, since they are not changed.
+ */
+bool CourseCatalog::ShouldCompact() const {
+    if (attached) {
+        return false;
+    }
+
+    size_t totalBytes = entries.size() * sizeof(Entry) + text.size() + prerequisiteIds.size() * sizeof(uint32_t);
+
+    return unusedBytes * compactionShare > totalBytes;
+}
+
+/**
+ * Copy the catalog into new arrays that hold only what is still used. The
+ * old text and prerequisite IDs of updated and removed courses are dropped,
+ * as is each removed course that no prerequisite refers to. The remaining
+ * courses keep their order, so courses with the same number stay in order
+ * of ID, but may get smaller IDs.
+ *
+ * @param newIds - Filled in with each old ID's new ID, or noCourse if the course was dropped.
+ */
+void CourseCatalog::Compact(vector<uint32_t>& newIds) {
+    detach();
+
+    // Keep every defined course, every interned placeholder, and every course that a prerequisite refers to.
+    vector<char> kept(entries.size(), 0);
+
+    for (uint32_t id = 0; id < entries.size(); id++) {
+        if (IsDefined(id)) {
+            kept[id] = 1;
+
+            for (uint32_t prerequisiteId : Prerequisites(id)) {
+                kept[prerequisiteId] = 1;
+            }
+        }
+    }
+
+    for (uint32_t id : slots) {
+        if (id != noCourse) {
+            kept[id] = 1;
+        }
+    }
+
+    newIds.assign(entries.size(), noCourse);
+
+    size_t keptCount = 0;
+    size_t keptText = 0;
+    size_t keptPrerequisites = 0;
+
+    for (uint32_t id = 0; id < entries.size(); id++) {
+        if (kept[id]) {
+            newIds[id] = static_cast<uint32_t>(keptCount++);
+            keptText += entries[id].numberLength + entries[id].nameLength;
+            keptPrerequisites += entries[id].prerequisiteCount;
+        }
+    }
+
+    vector<Entry> newEntries;
+    vector<char> newText;
+    vector<uint32_t> newPrerequisiteIds;
+
+    newEntries.reserve(keptCount);
+    newText.reserve(keptText);
+    newPrerequisiteIds.reserve(keptPrerequisites);
+
+    for (uint32_t id = 0; id < entries.size(); id++) {
+        if (!kept[id]) {
+            continue;
+        }
+
+        Entry entry = entries[id];
+        const char* entryText = text.data() + entry.textOffset;
+
+        entry.textOffset = newText.size();
+        newText.insert(newText.end(), entryText, entryText + entry.numberLength + entry.nameLength);
+
+        if (entry.prerequisiteOffset != placeholderOffset) {
+            entry.prerequisiteOffset = static_cast<uint32_t>(newPrerequisiteIds.size());
+
+            for (uint32_t prerequisiteId : Prerequisites(id)) {
+                newPrerequisiteIds.push_back(newIds[prerequisiteId]);
+            }
+        }
+
+        newEntries.push_back(entry);
+    }
+
+    // A slot's position depends only on the course number, so each interned ID is renumbered where it is.
+    for (uint32_t& id : slots) {
+        if (id != noCourse) {
+            id = newIds[id];
+        }
+    }
+
+    entries.swap(newEntries);
+    text.swap(newText);
+    prerequisiteIds.swap(newPrerequisiteIds);
+    unusedBytes = 0;
+}
+
+/**
+ * Find the ID of a course number.
+ *
+ * @param courseNumber - The upper-case course number.
+ * @return The course number's ID, or noCourse if it has not been interned.
  */
-void BinarySearchTree::PrintCourseInformation(string courseNumber) {
-    // Call the private method to find and print the given course number.
-    printCourseInformation(courseNumber);
+uint32_t CourseCatalog::Find(string_view courseNumber) const {
+    const uint32_t* slotData = attached ? attachedArrays.slots : slots.data();
+    size_t slotCount = attached ? attachedArrays.slotCount : slots.size();
+
+    if (slotCount == 0) {
+        return noCourse;
+    }
+
+    size_t mask = slotCount - 1;
+    size_t slot = hashNumber(courseNumber) & mask;
+
+    // Probe linearly until the course number or an empty slot is found.
+    while (slotData[slot] != noCourse) {
+        if (Number(slotData[slot]) == courseNumber) {
+            return slotData[slot];
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return noCourse;
 }
 
-//============================================================================
-// Static Methods
-//============================================================================
+/**
+ * Determine whether a course has been defined, rather than only referred to.
+ *
+ * @param id - The course's ID.
+ */
+bool CourseCatalog::IsDefined(uint32_t id) const {
+    return entryAt(id).prerequisiteOffset != placeholderOffset;
+}
+
+/**
+ * Get the number of course IDs in the catalog, including placeholders.
+ */
+size_t CourseCatalog::Size() const {
+    return attached ? attachedArrays.entryCount : entries.size();
+}
+
+/**
+ * Get a course's number.
+ *
+ * @param id - The course's ID.
+ */
+string_view CourseCatalog::Number(uint32_t id) const {
+    const Entry& entry = entryAt(id);
+
+    return string_view(textData() + entry.textOffset, entry.numberLength);
+}
+
+/**
+ * Get a course's name.
+ *
+ * @param id - The course's ID.
+ */
+string_view CourseCatalog::Name(uint32_t id) const {
+    const Entry& entry = entryAt(id);
+
+    return string_view(textData() + entry.textOffset + entry.numberLength, entry.nameLength);
+}
+
+/**
+ * Get the IDs of a course's prerequisites.
+ *
+ * @param id - The course's ID.
+ */
+CourseCatalog::IdRange CourseCatalog::Prerequisites(uint32_t id) const {
+    const Entry& entry = entryAt(id);
+    const uint32_t* prerequisiteData = attached ? attachedArrays.prerequisiteIds : prerequisiteIds.data();
+    const uint32_t* first = prerequisiteData + (IsDefined(id) ? entry.prerequisiteOffset : 0);
+
+    return { first, first + entry.prerequisiteCount };
+}
+
+/**
+ * Get the size of one entry record in the catalog's arrays.
+ */
+size_t CourseCatalog::EntrySize() {
+    return sizeof(Entry);
+}
+
+/**
+ * Check that arrays stored elsewhere, such as in a snapshot file, only refer
+ * within themselves, so that reading them never goes out of bounds.
+ *
+ * @param arrays - Arrays in the layout returned by GetArrays().
+ * @return Whether or not every text range, prerequisite range and ID is in range.
+ */
+bool CourseCatalog::CheckArrays(const Arrays& arrays) {
+    const Entry* firstEntry = static_cast<const Entry*>(arrays.entries);
+
+    // Every ID must be below noCourse.
+    if (arrays.entryCount >= noCourse) {
+        return false;
+    }
+
+    for (size_t id = 0; id < arrays.entryCount; id++) {
+        const Entry& entry = firstEntry[id];
+
+        // The number and name must be inside the text.
+        if (entry.textOffset > arrays.textSize || entry.numberLength > arrays.textSize - entry.textOffset
+                || entry.nameLength > arrays.textSize - entry.textOffset - entry.numberLength) {
+            return false;
+        }
+
+        // A placeholder has no prerequisites, and a defined course's must be inside the prerequisite IDs.
+        if (entry.prerequisiteOffset == placeholderOffset ? entry.prerequisiteCount != 0
+                : entry.prerequisiteOffset > arrays.prerequisiteCount
+                    || entry.prerequisiteCount > arrays.prerequisiteCount - entry.prerequisiteOffset) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < arrays.prerequisiteCount; i++) {
+        if (arrays.prerequisiteIds[i] >= arrays.entryCount) {
+            return false;
+        }
+    }
+
+    // Every slot is empty or holds an ID, and at least one is empty so that every probe stops.
+    bool emptySlot = false;
+
+    for (size_t slot = 0; slot < arrays.slotCount; slot++) {
+        if (arrays.slots[slot] == noCourse) {
+            emptySlot = true;
+        }
+        else if (arrays.slots[slot] >= arrays.entryCount) {
+            return false;
+        }
+    }
+
+    return arrays.slotCount == 0 || emptySlot;
+}
+
+/**
+ * Get the location of every array in the catalog, such as to write them to a file.
+ * The arrays are only valid until the catalog changes.
+ */
+CourseCatalog::Arrays CourseCatalog::GetArrays() const {
+    if (attached) {
+        return attachedArrays;
+    }
+
+    return { entries.data(), entries.size(), text.data(), text.size(),
+        prerequisiteIds.data(), prerequisiteIds.size(), slots.data(), slots.size() };
+}
+
+/**
+ * Replace the catalog with arrays stored elsewhere, which are read in place.
+ * The arrays must stay valid until the catalog is cleared or changed.
+ *
+ * @param arrays - Arrays in the layout returned by GetArrays(). The slot count must be a power of two.
+ */
+void CourseCatalog::Attach(const Arrays& arrays) {
+    Clear();
+
+    attachedArrays = arrays;
+    attached = true;
+}
+
+/**
+ * Replace the catalog with a copy of arrays stored elsewhere.
+ *
+ * @param arrays - Arrays in the layout returned by GetArrays(). They are only read during the call.
+ */
+void CourseCatalog::Assign(const Arrays& arrays) {
+    Attach(arrays);
+    detach();
+}
+
+//============================================================================
+// Frozen Index class definition
+//============================================================================
+
+// Hint the processor to start loading an address that will be read soon.
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address)
+#endif
+
+/**
+ * Define a class containing a read-only copy of a loaded catalog's search
+ * order, laid out for fast lookups.
+ *
+ * The packed course number keys are stored contiguously in Eytzinger
+ * (breadth-first) order, four to a cache line, so the first levels of every
+ * search share the same few cache lines and the next levels can be
+ * prefetched. The course IDs are kept in a separate array in ascending
+ * order of course number.
+ *
+ * The arrays are either built by the index itself or attached from
+ * elsewhere, such as a mapped snapshot file, and are never changed.
+ */
+class FrozenIndex {
+
+public:
+    // Define a structure to hold the location of every array in an index of a number of courses.
+    struct Arrays {
+        const CourseKey* keys;
+        const uint32_t* ranks;
+        const uint32_t* courseIds;
+        size_t size;
+    };
+
+private:
+    // The catalog that the course IDs refer to.
+    const CourseCatalog* catalog;
+
+    // The arrays built by Build(). They are empty when the index is attached.
+    vector<CourseKey> ownedKeys;
+    vector<uint32_t> ownedRanks;
+    vector<uint32_t> ownedCourseIds;
+
+    // The course number keys in Eytzinger order. Position 0 is unused so that the children of k are 2k and 2k + 1.
+    const CourseKey* keys;
+
+    // The ascending rank of the course at each Eytzinger position.
+    const uint32_t* ranks;
+
+    // The course IDs in ascending order of course number.
+    const uint32_t* courseIds;
+
+    size_t size;
+
+    size_t lowerBound(const CourseKey& key, string_view courseNumber) const;
+    void layOut(const vector<CourseKey>& sortedKeys);
+
+public:
+    FrozenIndex();
+    void Build(Node* root, const CourseCatalog& courseCatalog);
+    void Build(const CourseCatalog& courseCatalog);
+    static bool CheckArrays(const Arrays& arrays, size_t courseCount);
+    void Attach(const Arrays& arrays, const CourseCatalog& courseCatalog);
+    void Assign(const Arrays& arrays, const CourseCatalog& courseCatalog);
+    void Clear();
+    Arrays GetArrays() const;
+    size_t Size() const;
+    uint32_t At(size_t rank) const;
+    size_t LowerBound(string_view courseNumber) const;
+    uint32_t Find(string_view courseNumber) const;
+};
+
+/**
+ * Default constructor
+ */
+FrozenIndex::FrozenIndex() {
+    catalog = nullptr;
+    keys = nullptr;
+    ranks = nullptr;
+    courseIds = nullptr;
+    size = 0;
+}
+
+/**
+ * Build the index from a binary search tree.
+ *
+ * @param root - The root of the tree. It must not change while the index is in use.
+ * @param courseCatalog - The catalog that the tree's course IDs refer to.
+ */
+void FrozenIndex::Build(Node* root, const CourseCatalog& courseCatalog) {
+    Clear();
+
+    catalog = &courseCatalog;
+
+    // Collect the course IDs and their keys in order with an iterative in-order traversal.
+    vector<Node*> pendingNodes;
+    vector<CourseKey> sortedKeys;
+    Node* currentNode = root;
+
+    sortedKeys.reserve(courseCatalog.Size());
+    ownedCourseIds.reserve(courseCatalog.Size());
+
+    while (currentNode != nullptr || !pendingNodes.empty()) {
+        while (currentNode != nullptr) {
+            pendingNodes.push_back(currentNode);
+            currentNode = currentNode->left;
+        }
+
+        currentNode = pendingNodes.back();
+        pendingNodes.pop_back();
+
+        ownedCourseIds.push_back(currentNode->courseId);
+        sortedKeys.push_back(currentNode->key);
+
+        currentNode = currentNode->right;
+    }
+
+    layOut(sortedKeys);
+}
+
+/**
+ * Build the index from every course defined in a catalog, for a tree
+ * that has no nodes. The courses are sorted as Load() sorts them, so the
+ * index is the same as one built from the nodes that Load() would link.
+ *
+ * @param courseCatalog - The catalog. It must not change while the index is in use.
+ */
+void FrozenIndex::Build(const CourseCatalog& courseCatalog) {
+    Clear();
+
+    catalog = &courseCatalog;
+
+    // Define a structure to hold a course while the courses are sorted.
+    struct SortEntry {
+        CourseKey key;
+        uint32_t courseId;
+    };
+
+    vector<SortEntry> sortEntries;
+
+    for (uint32_t courseId = 0; courseId < courseCatalog.Size(); courseId++) {
+        if (courseCatalog.IsDefined(courseId)) {
+            sortEntries.push_back({ CourseKey(courseCatalog.Number(courseId)), courseId });
+        }
+    }
+
+    // Sort by course number. Equal course numbers stay in the order they were defined.
+    sort(sortEntries.begin(), sortEntries.end(), [&courseCatalog](const SortEntry& entry, const SortEntry& other) {
+        int comparison = entry.key.Compare(other.key);
+
+        if (comparison == 0 && !entry.key.IsPacked()) {
+            comparison = courseCatalog.Number(entry.courseId).compare(courseCatalog.Number(other.courseId));
+        }
+
+        return (comparison != 0) ? (comparison < 0) : (entry.courseId < other.courseId);
+    });
+
+    vector<CourseKey> sortedKeys;
+
+    sortedKeys.reserve(sortEntries.size());
+    ownedCourseIds.reserve(sortEntries.size());
+
+    for (const SortEntry& entry : sortEntries) {
+        sortedKeys.push_back(entry.key);
+        ownedCourseIds.push_back(entry.courseId);
+    }
+
+    // Release the sort entries before the Eytzinger arrays are allocated.
+    vector<SortEntry>().swap(sortEntries);
+
+    layOut(sortedKeys);
+}
+
+/**
+ * Lay out the keys of the courses in ownedCourseIds in Eytzinger order, and
+ * point the index at the owned arrays.
+ *
+ * @param sortedKeys - The key of each course in ownedCourseIds, in the same ascending order.
+ */
+void FrozenIndex::layOut(const vector<CourseKey>& sortedKeys) {
+    size = ownedCourseIds.size();
+
+    ownedKeys.resize(size + 1);
+    ownedRanks.resize(size + 1);
+
+    // Visit the implicit Eytzinger tree in order, starting at its left-most position.
+    size_t position = 1;
+
+    while (2 * position <= size) {
+        position *= 2;
+    }
+
+    for (size_t rank = 0; rank < size; rank++) {
+        ownedKeys[position] = sortedKeys[rank];
+        ownedRanks[position] = static_cast<uint32_t>(rank);
+
+        // If the position has a right child, continue at the left-most position below it.
+        if (2 * position + 1 <= size) {
+            position = 2 * position + 1;
+
+            while (2 * position <= size) {
+                position *= 2;
+            }
+        }
+        // Otherwise, climb past every ancestor whose right sub-tree is finished.
+        else {
+            while (position & 1) {
+                position >>= 1;
+            }
+
+            position >>= 1;
+        }
+    }
+
+    keys = ownedKeys.data();
+    ranks = ownedRanks.data();
+    courseIds = ownedCourseIds.data();
+}
+
+/**
+ * Use arrays stored elsewhere as the index, reading them in place.
+ * The arrays must stay valid until the index is cleared.
+ *
+ * @param arrays - Arrays in the layout returned by GetArrays().
+ * @param courseCatalog - The catalog that the course IDs refer to.
+ */
+void FrozenIndex::Attach(const Arrays& arrays, const CourseCatalog& courseCatalog) {
+    Clear();
+
+    catalog = &courseCatalog;
+    keys = arrays.keys;
+    ranks = arrays.ranks;
+    courseIds = arrays.courseIds;
+    size = arrays.size;
+}
+
+/**
+ * Check that arrays stored elsewhere, such as in a snapshot file, only refer
+ * within themselves and to a catalog's IDs.
+ *
+ * @param arrays - Arrays in the layout returned by GetArrays().
+ * @param courseCount - The number of IDs in the catalog that the course IDs refer to.
+ * @return Whether or not every rank and course ID is in range.
+ */
+bool FrozenIndex::CheckArrays(const Arrays& arrays, size_t courseCount) {
+    // Position 0 is unused, so only positions 1 to size hold ranks.
+    for (size_t position = 1; position <= arrays.size; position++) {
+        if (arrays.ranks[position] >= arrays.size) {
+            return false;
+        }
+    }
+
+    for (size_t rank = 0; rank < arrays.size; rank++) {
+        if (arrays.courseIds[rank] >= courseCount) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Replace the index with a copy of arrays stored elsewhere.
+ *
+ * @param arrays - Arrays in the layout returned by GetArrays(). They are only read during the call.
+ * @param courseCatalog - The catalog that the course IDs refer to.
+ */
+void FrozenIndex::Assign(const Arrays& arrays, const CourseCatalog& courseCatalog) {
+    Clear();
+
+    catalog = &courseCatalog;
+
+    // An index that was never built has no arrays at all.
+    if (arrays.keys == nullptr) {
+        return;
+    }
+
+    ownedKeys.assign(arrays.keys, arrays.keys + arrays.size + 1);
+    ownedRanks.assign(arrays.ranks, arrays.ranks + arrays.size + 1);
+    ownedCourseIds.assign(arrays.courseIds, arrays.courseIds + arrays.size);
+
+    keys = ownedKeys.data();
+    ranks = ownedRanks.data();
+    courseIds = ownedCourseIds.data();
+    size = arrays.size;
+}
+
+/**
+ * Remove every course from the index.
+ */
+void FrozenIndex::Clear() {
+    ownedKeys.clear();
+    ownedRanks.clear();
+    ownedCourseIds.clear();
+
+    keys = nullptr;
+    ranks = nullptr;
+    courseIds = nullptr;
+    size = 0;
+}
+
+/**
+ * Get the location of every array in the index, such as to write them to a file.
+ * The keys and ranks arrays hold Size() + 1 elements, because position 0 is unused.
+ */
+FrozenIndex::Arrays FrozenIndex::GetArrays() const {
+    return { keys, ranks, courseIds, size };
+}
+
+/**
+ * Get the number of courses in the index.
+ */
+size_t FrozenIndex::Size() const {
+    return size;
+}
+
+/**
+ * Get a course ID by its ascending rank.
+ *
+ * @param rank - The rank of the course, from 0 to Size() - 1.
+ */
+uint32_t FrozenIndex::At(size_t rank) const {
+    return courseIds[rank];
+}
+
+/**
+ * Find the Eytzinger position of the first course that is not smaller than a course number.
+ *
+ * @param key - The packed course number.
+ * @param courseNumber - The full course number.
+ * @return The position of the course, or 0 if every course is smaller.
+ */
+size_t FrozenIndex::lowerBound(const CourseKey& key, string_view courseNumber) const {
+    size_t position = 1;
+
+    // Descend without branching on the comparison. Each step moves to the left or right child.
+    while (position <= size) {
+        // Start loading the four keys two levels down, one cache line, while this level is compared.
+        if (4 * position <= size) {
+            PREFETCH(&keys[4 * position]);
+        }
+
+        const CourseKey& currentKey = keys[position];
+
+        PLANNER_STAT_COMPARISON();
+
+        // Only course numbers too long to pack ever need their strings compared.
+        bool isLess = (currentKey.high != key.high) ? (currentKey.high < key.high)
+            : (currentKey.low != key.low) ? (currentKey.low < key.low)
+            : (!key.IsPacked() && catalog->Number(courseIds[ranks[position]]) < courseNumber);
+
+        position = 2 * position + (isLess ? 1 : 0);
+    }
+
+    // Undo the right turns taken after the last left turn to reach the lower bound.
+    while (position & 1) {
+        position >>= 1;
+    }
+
+    return position >> 1;
+}
+
+/**
+ * Find the rank of the first course that is not smaller than a course number.
+ *
+ * @param courseNumber - The upper-case course number.
+ * @return The rank of the course, or Size() if every course is smaller.
+ */
+size_t FrozenIndex::LowerBound(string_view courseNumber) const {
+    size_t position = lowerBound(CourseKey(courseNumber), courseNumber);
+
+    return (position == 0) ? size : ranks[position];
+}
+
+/**
+ * Find a course by its course number.
+ *
+ * @param courseNumber - The upper-case course number to find.
+ * @return The ID of the first course with the course number, or noCourse if there is none.
+ */
+uint32_t FrozenIndex::Find(string_view courseNumber) const {
+    CourseKey key(courseNumber);
+    size_t position = lowerBound(key, courseNumber);
+
+    // If every key is smaller, or the lower bound is a different course...
+    if (position == 0 || !(keys[position] == key)) {
+        return CourseCatalog::noCourse;
+    }
+
+    uint32_t courseId = courseIds[ranks[position]];
+
+    // Long course numbers that share a packed prefix must match in full.
+    if (!key.IsPacked() && catalog->Number(courseId) != courseNumber) {
+        return CourseCatalog::noCourse;
+    }
+
+    return courseId;
+}
+
+//============================================================================
+// Name Index class definition
+//============================================================================
+
+/**
+ * Define a class containing an inverted index of the words in every
+ * course name, so that courses can be searched by keyword.
+ *
+ * A name's words are its runs of ASCII letters and digits, compared
+ * without regard to case. Each distinct word is stored once, in upper case,
+ * and found through an open-addressing hash table. Its postings are the
+ * ascending ranks of the courses whose names contain it, in a frozen
+ * index's order, stored back to back in one flat array (compressed sparse
+ * row). Because ranks follow course number order, intersecting the lists
+ * of a query's words gives the matching courses already in order.
+ *
+ * Like the frozen index, the arrays are either built by the index itself
+ * or attached from a mapped snapshot file, and are never changed.
+ */
+class NameIndex {
+
+public:
+    // Define a structure to hold the location of every array in an index of a number of words.
+    struct Arrays {
+        const char* wordText;
+        size_t wordTextSize;
+        const uint32_t* wordOffsets;
+        const uint32_t* postingOffsets;
+        size_t wordCount;
+        const uint32_t* postings;
+        size_t postingCount;
+        const uint32_t* slots;
+        size_t slotCount;
+    };
+
+private:
+    // The ID returned when there is no such word.
+    static constexpr uint32_t noWord = UINT32_MAX;
+
+    // The arrays built by Build(). They are empty when the index is attached.
+    vector<char> ownedWordText;
+    vector<uint32_t> ownedWordOffsets;
+    vector<uint32_t> ownedPostingOffsets;
+    vector<uint32_t> ownedPostings;
+    vector<uint32_t> ownedSlots;
+
+    // The upper-case text of every word, back to back. Word k is between wordOffsets[k] and wordOffsets[k + 1].
+    const char* wordText;
+    const uint32_t* wordOffsets;
+
+    // The ranks of the courses containing word k are between postingOffsets[k] and postingOffsets[k + 1].
+    const uint32_t* postingOffsets;
+    const uint32_t* postings;
+
+    // The hash table of word IDs. Empty slots hold noWord.
+    const uint32_t* slots;
+    size_t slotCount;
+
+    size_t wordCount;
+
+    template <typename Visit>
+    static void forEachWord(string_view text, Visit visit);
+    static char upperCase(char c);
+    static uint64_t hashWord(string_view word);
+    static size_t gallopTo(const uint32_t* postingList, size_t size, size_t first, uint32_t rank);
+
+    uint32_t findWord(string_view word) const;
+    uint32_t addWord(string_view word);
+    void addSlot(uint32_t id);
+    void useOwnedArrays();
+
+public:
+    NameIndex();
+    void Build(const CourseCatalog& catalog, const FrozenIndex& frozenIndex);
+    static bool CheckArrays(const Arrays& arrays, size_t rankCount);
+    void Attach(const Arrays& arrays);
+    void Assign(const Arrays& arrays);
+    void Clear();
+    Arrays GetArrays() const;
+    void Search(string_view words, vector<uint32_t>& ranks) const;
+};
+
+/**
+ * Default constructor
+ */
+NameIndex::NameIndex() {
+    Clear();
+}
+
+/**
+ * Call a function with each word of a text. The words keep their case.
+ *
+ * @param text - The text to split into words.
+ * @param visit - Called with each word.
+ */
+template <typename Visit>
+void NameIndex::forEachWord(string_view text, Visit visit) {
+    // Whether a character is an ASCII letter or digit. Other bytes, including UTF-8 sequences, separate words.
+    auto isWordCharacter = [](char c) {
+        char lower = static_cast<char>(c | 0x20);
+
+        return (c >= '0' && c <= '9') || (lower >= 'a' && lower <= 'z');
+    };
+
+    size_t position = 0;
+
+    while (position < text.size()) {
+        // Skip everything that is not a letter or a digit.
+        while (position < text.size() && !isWordCharacter(text[position])) {
+            position++;
+        }
+
+        size_t wordStart = position;
+
+        while (position < text.size() && isWordCharacter(text[position])) {
+            position++;
+        }
+
+        if (position > wordStart) {
+            visit(text.substr(wordStart, position - wordStart));
+        }
+    }
+}
+
+/**
+ * Convert a letter or digit of a word to upper case.
+ *
+ * @param c - An ASCII letter or digit.
+ */
+char NameIndex::upperCase(char c) {
+    return (c >= 'a') ? static_cast<char>(c & ~0x20) : c;
+}
+
+/**
+ * Hash a word's upper-case letters with 64-bit FNV-1a.
+ *
+ * @param word - The word to hash, in any case.
+ */
+uint64_t NameIndex::hashWord(string_view word) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (char c : word) {
+        hash = (hash ^ static_cast<unsigned char>(upperCase(c))) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * Find the first posting that is not smaller than a rank, by doubling the
+ * step from a starting position and then searching the last step. This
+ * costs O(log d) for a distance d, so a short list can be intersected with
+ * a long one without reading all of it.
+ *
+ * @param postingList - The ascending ranks.
+ * @param size - The number of ranks.
+ * @param first - The position to start at.
+ * @param rank - The rank to find.
+ * @return The position of the first rank not smaller than the rank, or size if there is none.
+ */
+size_t NameIndex::gallopTo(const uint32_t* postingList, size_t size, size_t first, uint32_t rank) {
+    size_t step = 1;
+    size_t last = first;
+
+    // Double the step until a rank that is not smaller is passed.
+    while (last < size && postingList[last] < rank) {
+        first = last + 1;
+        last = first + step;
+        step *= 2;
+    }
+
+    return static_cast<size_t>(lower_bound(postingList + first, postingList + min(last, size), rank) - postingList);
+}
+
+/**
+ * Find a word's ID.
+ *
+ * @param word - The word, in any case.
+ * @return The word's ID, or noWord if no course name contains it.
+ */
+uint32_t NameIndex::findWord(string_view word) const {
+    if (slotCount == 0) {
+        return noWord;
+    }
+
+    size_t mask = slotCount - 1;
+    size_t slot = hashWord(word) & mask;
+
+    // Probe linearly until the word or an empty slot is found.
+    while (slots[slot] != noWord) {
+        uint32_t id = slots[slot];
+        const char* storedWord = wordText + wordOffsets[id];
+
+        if (wordOffsets[id + 1] - wordOffsets[id] == word.size()) {
+            size_t i = 0;
+
+            while (i < word.size() && upperCase(word[i]) == storedWord[i]) {
+                i++;
+            }
+
+            if (i == word.size()) {
+                return id;
+            }
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return noWord;
+}
+
+/**
+ * Store a new word in upper case and add it to the hash table.
+ *
+ * @param word - The word, in any case. It must not be stored yet.
+ * @return The word's new ID.
+ */
+uint32_t NameIndex::addWord(string_view word) {
+    uint32_t id = static_cast<uint32_t>(ownedWordOffsets.size() - 1);
+
+    for (char c : word) {
+        ownedWordText.push_back(upperCase(c));
+    }
+
+    ownedWordOffsets.push_back(static_cast<uint32_t>(ownedWordText.size()));
+
+    // Keep the table at most half full so that probes stay short.
+    if ((id + 1) * 2 > ownedSlots.size()) {
+        ownedSlots.assign(max<size_t>(ownedSlots.size() * 2, 16), noWord);
+
+        for (uint32_t existingId = 0; existingId < id; existingId++) {
+            addSlot(existingId);
+        }
+    }
+
+    addSlot(id);
+    useOwnedArrays();
+
+    return id;
+}
+
+/**
+ * Add a stored word's ID to the hash table.
+ *
+ * @param id - The ID to add.
+ */
+void NameIndex::addSlot(uint32_t id) {
+    string_view word(ownedWordText.data() + ownedWordOffsets[id], ownedWordOffsets[id + 1] - ownedWordOffsets[id]);
+    size_t mask = ownedSlots.size() - 1;
+    size_t slot = hashWord(word) & mask;
+
+    // Probe linearly for an empty slot.
+    while (ownedSlots[slot] != noWord) {
+        slot = (slot + 1) & mask;
+    }
+
+    ownedSlots[slot] = id;
+}
+
+/**
+ * Point the arrays that are read at the index's own storage.
+ */
+void NameIndex::useOwnedArrays() {
+    wordText = ownedWordText.data();
+    wordOffsets = ownedWordOffsets.data();
+    postingOffsets = ownedPostingOffsets.data();
+    postings = ownedPostings.data();
+    slots = ownedSlots.data();
+    slotCount = ownedSlots.size();
+    wordCount = ownedWordOffsets.size() - 1;
+}
+
+/**
+ * Index the words of every course name in a frozen index.
+ *
+ * @param catalog - The catalog holding the course names.
+ * @param frozenIndex - The index giving each course's rank.
+ */
+void NameIndex::Build(const CourseCatalog& catalog, const FrozenIndex& frozenIndex) {
+    Clear();
+
+    size_t courseCount = frozenIndex.Size();
+
+    // Start the hash table big enough for a few distinct words per course, so it rarely grows.
+    size_t initialSlotCount = 16;
+
+    while (initialSlotCount < 2 * courseCount) {
+        initialSlotCount *= 2;
+    }
+
+    ownedSlots.assign(initialSlotCount, noWord);
+    useOwnedArrays();
+
+    // The rank of each course ID, or noWord if the course is not in the index.
+    vector<uint32_t> ranks(catalog.Size(), noWord);
+
+    for (size_t rank = 0; rank < courseCount; rank++) {
+        ranks[frozenIndex.At(rank)] = static_cast<uint32_t>(rank);
+    }
+
+    // The IDs of each course's distinct words, by course ID. The names are split in the order they are
+    // stored, which reads the catalog's text sequentially, instead of in rank order, which jumps around it.
+    vector<uint32_t> nameWordIds;
+    vector<uint32_t> nameWordOffsets(catalog.Size() + 1, 0);
+    vector<uint32_t> postingCounts;
+
+    nameWordIds.reserve(4 * courseCount);
+
+    for (uint32_t courseId = 0; courseId < catalog.Size(); courseId++) {
+        if (ranks[courseId] != noWord) {
+            forEachWord(catalog.Name(courseId), [&](string_view word) {
+                uint32_t id = findWord(word);
+
+                // If this is the first name with the word...
+                if (id == noWord) {
+                    id = addWord(word);
+                    postingCounts.push_back(0);
+                }
+
+                // A word repeated in one name is only posted once.
+                if (find(nameWordIds.begin() + nameWordOffsets[courseId], nameWordIds.end(), id) == nameWordIds.end()) {
+                    nameWordIds.push_back(id);
+                    postingCounts[id]++;
+                }
+            });
+        }
+
+        nameWordOffsets[courseId + 1] = static_cast<uint32_t>(nameWordIds.size());
+    }
+
+    // Give each word its range of the postings array.
+    ownedPostingOffsets.assign(wordCount + 1, 0);
+
+    for (size_t id = 0; id < wordCount; id++) {
+        ownedPostingOffsets[id + 1] = ownedPostingOffsets[id] + postingCounts[id];
+    }
+
+    // Fill each word's range in ascending order of rank. The counts become each range's next free position.
+    ownedPostings.resize(ownedPostingOffsets.back());
+    copy(ownedPostingOffsets.begin(), ownedPostingOffsets.end() - 1, postingCounts.begin());
+
+    for (size_t rank = 0; rank < courseCount; rank++) {
+        uint32_t courseId = frozenIndex.At(rank);
+
+        for (uint32_t i = nameWordOffsets[courseId]; i < nameWordOffsets[courseId + 1]; i++) {
+            ownedPostings[postingCounts[nameWordIds[i]]++] = static_cast<uint32_t>(rank);
+        }
+    }
+
+    useOwnedArrays();
+}
+
+/**
+ * Read the index from arrays stored elsewhere, without copying them.
+ * The arrays must stay valid until the index is cleared.
+ *
+ * @param arrays - The location of every array.
+ */
+void NameIndex::Attach(const Arrays& arrays) {
+    Clear();
+
+    wordText = arrays.wordText;
+    wordOffsets = arrays.wordOffsets;
+    postingOffsets = arrays.postingOffsets;
+    postings = arrays.postings;
+    slots = arrays.slots;
+    slotCount = arrays.slotCount;
+    wordCount = arrays.wordCount;
+}
+
+/**
+ * Check that arrays stored elsewhere, such as in a snapshot file, only refer
+ * within themselves and to an index's ranks.
+ *
+ * @param arrays - The location of every array.
+ * @param rankCount - The number of ranks in the frozen index that the postings refer to.
+ * @return Whether or not every offset, posting and word ID is in range.
+ */
+bool NameIndex::CheckArrays(const Arrays& arrays, size_t rankCount) {
+    // Every word ID must be below noWord.
+    if (arrays.wordCount >= noWord) {
+        return false;
+    }
+
+    // Each word's text and postings run from its offset to the next one's.
+    for (size_t id = 0; id < arrays.wordCount; id++) {
+        if (arrays.wordOffsets[id] > arrays.wordOffsets[id + 1]
+                || arrays.postingOffsets[id] > arrays.postingOffsets[id + 1]) {
+            return false;
+        }
+    }
+
+    if (arrays.wordOffsets[arrays.wordCount] > arrays.wordTextSize
+            || arrays.postingOffsets[arrays.wordCount] > arrays.postingCount) {
+        return false;
+    }
+
+    for (size_t i = 0; i < arrays.postingCount; i++) {
+        if (arrays.postings[i] >= rankCount) {
+            return false;
+        }
+    }
+
+    // Every slot is empty or holds a word ID, and at least one is empty so that every probe stops.
+    bool emptySlot = false;
+
+    for (size_t slot = 0; slot < arrays.slotCount; slot++) {
+        if (arrays.slots[slot] == noWord) {
+            emptySlot = true;
+        }
+        else if (arrays.slots[slot] >= arrays.wordCount) {
+            return false;
+        }
+    }
+
+    return arrays.slotCount == 0 || emptySlot;
+}
+
+/**
+ * Replace the index with a copy of arrays stored elsewhere.
+ *
+ * @param arrays - The location of every array.
+ */
+void NameIndex::Assign(const Arrays& arrays) {
+    Clear();
+
+    ownedWordText.assign(arrays.wordText, arrays.wordText + arrays.wordTextSize);
+    ownedWordOffsets.assign(arrays.wordOffsets, arrays.wordOffsets + arrays.wordCount + 1);
+    ownedPostingOffsets.assign(arrays.postingOffsets, arrays.postingOffsets + arrays.wordCount + 1);
+    ownedPostings.assign(arrays.postings, arrays.postings + arrays.postingCount);
+    ownedSlots.assign(arrays.slots, arrays.slots + arrays.slotCount);
+
+    useOwnedArrays();
+}
+
+/**
+ * Remove every word from the index and release its memory.
+ */
+void NameIndex::Clear() {
+    vector<char>().swap(ownedWordText);
+    vector<uint32_t>(1, 0).swap(ownedWordOffsets);
+    vector<uint32_t>(1, 0).swap(ownedPostingOffsets);
+    vector<uint32_t>().swap(ownedPostings);
+    vector<uint32_t>().swap(ownedSlots);
+
+    useOwnedArrays();
+}
+
+/**
+ * Get the location of every array in the index, such as to write them to a file.
+ */
+NameIndex::Arrays NameIndex::GetArrays() const {
+    return { wordText, wordOffsets[wordCount], wordOffsets, postingOffsets, wordCount,
+        postings, postingOffsets[wordCount], slots, slotCount };
+}
+
+/**
+ * Find the courses whose names contain every word of a query.
+ *
+ * @param words - The query. Case and punctuation are ignored.
+ * @param ranks - Receives the ascending ranks of the matching courses.
+ */
+void NameIndex::Search(string_view words, vector<uint32_t>& ranks) const {
+    ranks.clear();
+
+    vector<uint32_t> ids;
+    bool missingWord = false;
+
+    forEachWord(words, [&](string_view word) {
+        uint32_t id = findWord(word);
+
+        if (id == noWord) {
+            missingWord = true;
+        }
+        else {
+            ids.push_back(id);
+        }
+    });
+
+    // If a word is in no course name, or there are no words at all...
+    if (missingWord || ids.empty()) {
+        return;
+    }
+
+    // Ignore repeated words.
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+
+    // Intersect from the shortest list, which bounds the result, to the longest.
+    sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) {
+        return postingOffsets[a + 1] - postingOffsets[a] < postingOffsets[b + 1] - postingOffsets[b];
+    });
+
+    ranks.assign(postings + postingOffsets[ids[0]], postings + postingOffsets[ids[0] + 1]);
+
+    for (size_t i = 1; i < ids.size() && !ranks.empty(); i++) {
+        const uint32_t* postingList = postings + postingOffsets[ids[i]];
+        size_t size = postingOffsets[ids[i] + 1] - postingOffsets[ids[i]];
+        size_t position = 0;
+        size_t kept = 0;
+
+        // Keep only the ranks that are also in this word's list.
+        for (uint32_t rank : ranks) {
+            position = gallopTo(postingList, size, position, rank);
+
+            if (position == size) {
+                break;
+            }
+
+            if (postingList[position] == rank) {
+                ranks[kept++] = rank;
+            }
+        }
+
+        ranks.resize(kept);
+    }
+}
+
+//============================================================================
+// Prerequisite Graph class definition
+//============================================================================
+
+/**
+ * Count the zero bits below the lowest set bit of a word.
+ *
+ * @param bits - The word. It must not be zero.
+ */
+inline int countTrailingZeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int count = 0;
+
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        count++;
+    }
+
+    return count;
+#endif
+}
+
+// Define a structure to hold the working arrays of the semester planner, and the last plan it made.
+// A caller that plans many schedules keeps one per thread, so that each plan does not allocate.
+struct PlanBuffers {
+    // The goal nodes of the next plan.
+    vector<uint32_t> goalNodes;
+
+    // The planned nodes, term by term. Term k is between termOffsets[k] and termOffsets[k + 1].
+    vector<uint32_t> plannedNodes;
+    vector<uint32_t> termOffsets;
+
+    // By node: the plan that last visited the node, and the node's position among that plan's needed nodes.
+    vector<uint32_t> visitMarks;
+    vector<uint32_t> neededPositions;
+    uint32_t visitMark;
+
+    // By position among the needed nodes, which are sorted by depth.
+    vector<uint32_t> neededNodes;
+    vector<uint32_t> heights;
+    vector<uint32_t> remainingPrerequisites;
+    vector<uint32_t> dependentOffsets;
+    vector<uint32_t> dependents;
+
+    // The positions that can be taken in the next term, as a heap.
+    vector<uint32_t> readyPositions;
+
+    // Default constructor.
+    PlanBuffers() {
+        visitMark = 0;
+    }
+};
+
+/**
+ * Define a class containing the prerequisite graph of a catalog, with
+ * integer nodes and adjacency arrays.
+ *
+ * Each node's prerequisites and dependents (the courses that require it)
+ * are stored back to back in two flat arrays (compressed sparse row), so
+ * every traversal is linear in the size of the graph.
+ *
+ * For a loaded catalog, the nodes are the courses' ranks in a frozen
+ * index, so results ordered by node are in course number order. For a
+ * parsed csv file, they are the courses' line indices.
+ *
+ * The transitive prerequisites and dependents of every course are cached
+ * as rows of two bit matrices when the catalog is small enough, and found
+ * with a bitset-marked traversal otherwise. The depth of every course, the
+ * length of its longest chain of prerequisites, is stored with the graph
+ * so that a plan can order its courses without a sort of the whole graph.
+ */
+class PrerequisiteGraph {
+
+public:
+    // Define a structure to hold the location of every array in a graph of a number of nodes and edges.
+    struct Arrays {
+        const uint32_t* prerequisiteOffsets;
+        const uint32_t* prerequisites;
+        const uint32_t* dependentOffsets;
+        const uint32_t* dependents;
+        const uint32_t* depths;
+        size_t nodeCount;
+        size_t edgeCount;
+    };
+
+    // The depth of a node on or after a cycle, which has no longest chain of prerequisites.
+    static constexpr uint32_t noDepth = UINT32_MAX;
+
+private:
+    // The most nodes whose closures are cached. Each matrix then takes at most 2 MB.
+    static constexpr size_t maxMatrixSize = 4096;
+
+    // The arrays built by Build(). They are empty when the graph is attached.
+    vector<uint32_t> ownedPrerequisiteOffsets;
+    vector<uint32_t> ownedPrerequisites;
+    vector<uint32_t> ownedDependentOffsets;
+    vector<uint32_t> ownedDependents;
+    vector<uint32_t> ownedDepths;
+
+    // The prerequisites of node k are between prerequisiteOffsets[k] and prerequisiteOffsets[k + 1].
+    const uint32_t* prerequisiteOffsets;
+    const uint32_t* prerequisites;
+
+    // The dependents of node k, in ascending order, are between dependentOffsets[k] and dependentOffsets[k + 1].
+    const uint32_t* dependentOffsets;
+    const uint32_t* dependents;
+
+    // The number of prerequisites in the longest chain before node k, or noDepth.
+    const uint32_t* depths;
+
+    size_t nodeCount;
+
+    // Row k holds a bit for each transitive prerequisite of node k. It is empty for large or cyclic graphs.
+    vector<uint64_t> closureMatrix;
+
+    // Row k holds a bit for each transitive dependent of node k. It is empty when closureMatrix is.
+    vector<uint64_t> dependentMatrix;
+    size_t rowWords;
+
+    void useOwnedArrays();
+    void buildDependents();
+    void buildDepths();
+    void buildClosureMatrix();
+    void reach(uint32_t node, const uint32_t* edgeOffsets, const uint32_t* edges,
+        const vector<uint64_t>& matrix, vector<uint32_t>& nodes) const;
+
+public:
+    PrerequisiteGraph();
+    void Build(const ParsedCatalog& parsedCatalog);
+    void Build(const CourseCatalog& catalog, const FrozenIndex& frozenIndex);
+    void Build(const CourseCatalog& catalog, const vector<uint32_t>& courseIds);
+    static bool CheckArrays(const Arrays& arrays);
+    void Attach(const Arrays& arrays);
+    void Assign(const Arrays& arrays);
+    void Clear();
+    Arrays GetArrays() const;
+    size_t Size() const;
+    CourseCatalog::IdRange Prerequisites(uint32_t node) const;
+    CourseCatalog::IdRange Dependents(uint32_t node) const;
+    bool FindCycle(vector<uint32_t>& cycle) const;
+    void Closure(uint32_t node, vector<uint32_t>& nodes) const;
+    void DependentClosure(uint32_t node, vector<uint32_t>& nodes) const;
+    bool TopologicalOrder(vector<uint32_t>& order) const;
+    uint32_t Depth(uint32_t node) const;
+    bool Plan(size_t termLimit, PlanBuffers& buffers) const;
+};
+
+/**
+ * Default constructor
+ */
+PrerequisiteGraph::PrerequisiteGraph() {
+    Clear();
+}
+
+/**
+ * Point the arrays that are read at the graph's own storage.
+ */
+void PrerequisiteGraph::useOwnedArrays() {
+    prerequisiteOffsets = ownedPrerequisiteOffsets.data();
+    prerequisites = ownedPrerequisites.data();
+    dependentOffsets = ownedDependentOffsets.data();
+    dependents = ownedDependents.data();
+    depths = ownedDepths.data();
+    nodeCount = ownedPrerequisiteOffsets.size() - 1;
+}
+
+/**
+ * Build the dependents arrays by reversing every prerequisite edge.
+ * Nodes are visited in ascending order, so each list comes out sorted.
+ */
+void PrerequisiteGraph::buildDependents() {
+    ownedDependentOffsets.assign(nodeCount + 1, 0);
+    ownedDependents.resize(ownedPrerequisites.size());
+
+    for (uint32_t prerequisite : ownedPrerequisites) {
+        ownedDependentOffsets[prerequisite + 1]++;
+    }
+
+    for (size_t node = 0; node < nodeCount; node++) {
+        ownedDependentOffsets[node + 1] += ownedDependentOffsets[node];
+    }
+
+    // The next free position in each node's list.
+    vector<uint32_t> nextDependent(ownedDependentOffsets.begin(), ownedDependentOffsets.end() - 1);
+
+    for (uint32_t node = 0; node < nodeCount; node++) {
+        for (uint32_t prerequisite : Prerequisites(node)) {
+            ownedDependents[nextDependent[prerequisite]++] = node;
+        }
+    }
+
+    useOwnedArrays();
+}
+
+/**
+ * Find the depth of every node. A node's prerequisites all come before it
+ * in topological order, so their depths are known when it is reached.
+ */
+void PrerequisiteGraph::buildDepths() {
+    ownedDepths.assign(nodeCount, noDepth);
+
+    vector<uint32_t> order;
+
+    TopologicalOrder(order);
+
+    for (uint32_t node : order) {
+        uint32_t depth = 0;
+
+        for (uint32_t prerequisite : Prerequisites(node)) {
+            depth = max(depth, ownedDepths[prerequisite] + 1);
+        }
+
+        ownedDepths[node] = depth;
+    }
+
+    useOwnedArrays();
+}
+
+/**
+ * Cache the transitive prerequisites and dependents of every node as bit
+ * matrices, if the graph is small and acyclic. Each prerequisite row is the
+ * union of its prerequisites' rows, so those rows are filled in topological
+ * order, and the dependent rows in reverse.
+ */
+void PrerequisiteGraph::buildClosureMatrix() {
+    closureMatrix.clear();
+    dependentMatrix.clear();
+    rowWords = (Size() + 63) / 64;
+
+    vector<uint32_t> order;
+
+    if (Size() > maxMatrixSize || !TopologicalOrder(order)) {
+        return;
+    }
+
+    closureMatrix.assign(Size() * rowWords, 0);
+
+    for (uint32_t node : order) {
+        uint64_t* row = &closureMatrix[node * rowWords];
+
+        for (uint32_t prerequisite : Prerequisites(node)) {
+            const uint64_t* prerequisiteRow = &closureMatrix[prerequisite * rowWords];
+
+            for (size_t word = 0; word < rowWords; word++) {
+                row[word] |= prerequisiteRow[word];
+            }
+
+            row[prerequisite / 64] |= uint64_t(1) << (prerequisite % 64);
+        }
+    }
+
+    dependentMatrix.assign(Size() * rowWords, 0);
+
+    for (auto node = order.rbegin(); node != order.rend(); node++) {
+        uint64_t* row = &dependentMatrix[*node * rowWords];
+
+        for (uint32_t dependent : Dependents(*node)) {
+            const uint64_t* dependentRow = &dependentMatrix[dependent * rowWords];
+
+            for (size_t word = 0; word < rowWords; word++) {
+                row[word] |= dependentRow[word];
+            }
+
+            row[dependent / 64] |= uint64_t(1) << (dependent % 64);
+        }
+    }
+}
+
+/**
+ * Build the graph of a parsed csv file. Its nodes are line indices.
+ * Every prerequisite must already be resolved by checkFileFormat.
+ *
+ * @param parsedCatalog - The courses parsed from the csv file.
+ */
+void PrerequisiteGraph::Build(const ParsedCatalog& parsedCatalog) {
+    Clear();
+
+    ownedPrerequisiteOffsets.reserve(parsedCatalog.courses.size() + 1);
+    ownedPrerequisites.reserve(parsedCatalog.prerequisiteCourses.size());
+
+    for (const ParsedCourse& course : parsedCatalog.courses) {
+        ownedPrerequisites.insert(ownedPrerequisites.end(),
+            parsedCatalog.prerequisiteCourses.begin() + course.prerequisiteOffset,
+            parsedCatalog.prerequisiteCourses.begin() + course.prerequisiteOffset + course.prerequisiteCount);
+        ownedPrerequisiteOffsets.push_back(static_cast<uint32_t>(ownedPrerequisites.size()));
+    }
+
+    useOwnedArrays();
+    buildDependents();
+    buildDepths();
+}
+
+/**
+ * Build the graph of some courses in a catalog. Its nodes are indices in a
+ * list of course IDs. Prerequisites that are not in the list are left out.
+ *
+ * @param catalog - The catalog holding each course's prerequisite IDs.
+ * @param courseIds - The course ID of each node.
+ */
+void PrerequisiteGraph::Build(const CourseCatalog& catalog, const vector<uint32_t>& courseIds) {
+    Clear();
+
+    // The node of each course ID.
+    vector<uint32_t> nodes(catalog.Size(), CourseCatalog::noCourse);
+
+    for (size_t node = 0; node < courseIds.size(); node++) {
+        nodes[courseIds[node]] = static_cast<uint32_t>(node);
+    }
+
+    ownedPrerequisiteOffsets.reserve(courseIds.size() + 1);
+
+    for (uint32_t courseId : courseIds) {
+        for (uint32_t prerequisiteId : catalog.Prerequisites(courseId)) {
+            if (nodes[prerequisiteId] != CourseCatalog::noCourse) {
+                ownedPrerequisites.push_back(nodes[prerequisiteId]);
+            }
+        }
+
+        ownedPrerequisiteOffsets.push_back(static_cast<uint32_t>(ownedPrerequisites.size()));
+    }
+
+    useOwnedArrays();
+    buildDependents();
+    buildDepths();
+}
+
+/**
+ * Build the graph of a loaded catalog. Its nodes are ranks in a frozen index.
+ *
+ * @param catalog - The catalog holding each course's prerequisite IDs.
+ * @param frozenIndex - The index giving each course's rank.
+ */
+void PrerequisiteGraph::Build(const CourseCatalog& catalog, const FrozenIndex& frozenIndex) {
+    Clear();
+
+    // The rank of each course ID. Prerequisites only refer to the first course with each course number.
+    vector<uint32_t> ranks(catalog.Size(), CourseCatalog::noCourse);
+
+    for (size_t rank = 0; rank < frozenIndex.Size(); rank++) {
+        ranks[frozenIndex.At(rank)] = static_cast<uint32_t>(rank);
+    }
+
+    ownedPrerequisiteOffsets.reserve(frozenIndex.Size() + 1);
+
+    for (size_t rank = 0; rank < frozenIndex.Size(); rank++) {
+        for (uint32_t prerequisiteId : catalog.Prerequisites(frozenIndex.At(rank))) {
+            // A checked catalog never refers to a course that is not loaded.
+            if (ranks[prerequisiteId] != CourseCatalog::noCourse) {
+                ownedPrerequisites.push_back(ranks[prerequisiteId]);
+            }
+        }
+
+        ownedPrerequisiteOffsets.push_back(static_cast<uint32_t>(ownedPrerequisites.size()));
+    }
+
+    useOwnedArrays();
+    buildDependents();
+    buildDepths();
+    buildClosureMatrix();
+}
+
+/**
+ * Read the graph from arrays stored elsewhere, without copying them.
+ * The arrays must stay valid until the graph is cleared. Only the cached
+ * closures of a small graph are rebuilt.
+ *
+ * @param arrays - The location of every array.
+ */
+void PrerequisiteGraph::Attach(const Arrays& arrays) {
+    Clear();
+
+    prerequisiteOffsets = arrays.prerequisiteOffsets;
+    prerequisites = arrays.prerequisites;
+    dependentOffsets = arrays.dependentOffsets;
+    dependents = arrays.dependents;
+    depths = arrays.depths;
+    nodeCount = arrays.nodeCount;
+
+    buildClosureMatrix();
+}
+
+/**
+ * Check that arrays stored elsewhere, such as in a snapshot file, describe
+ * a graph whose edges stay within its nodes. Each node's dependents must be
+ * as many as the nodes that require it, and each depth must exceed its
+ * prerequisites' depths, since the order and plans rely on both.
+ *
+ * @param arrays - The location of every array.
+ * @return Whether or not every offset, node and depth is consistent.
+ */
+bool PrerequisiteGraph::CheckArrays(const Arrays& arrays) {
+    if (arrays.nodeCount >= noDepth) {
+        return false;
+    }
+
+    // Each node's edges run from its offset to the next one's, and every edge is listed once each way.
+    for (size_t node = 0; node < arrays.nodeCount; node++) {
+        if (arrays.prerequisiteOffsets[node] > arrays.prerequisiteOffsets[node + 1]
+                || arrays.dependentOffsets[node] > arrays.dependentOffsets[node + 1]) {
+            return false;
+        }
+    }
+
+    if (arrays.prerequisiteOffsets[0] != 0 || arrays.prerequisiteOffsets[arrays.nodeCount] != arrays.edgeCount
+            || arrays.dependentOffsets[0] != 0 || arrays.dependentOffsets[arrays.nodeCount] != arrays.edgeCount) {
+        return false;
+    }
+
+    // Count how many nodes require each node.
+    vector<uint32_t> dependentCounts(arrays.nodeCount, 0);
+
+    for (size_t edge = 0; edge < arrays.edgeCount; edge++) {
+        if (arrays.prerequisites[edge] >= arrays.nodeCount || arrays.dependents[edge] >= arrays.nodeCount) {
+            return false;
+        }
+
+        dependentCounts[arrays.prerequisites[edge]]++;
+    }
+
+    for (size_t node = 0; node < arrays.nodeCount; node++) {
+        if (arrays.dependentOffsets[node + 1] - arrays.dependentOffsets[node] != dependentCounts[node]) {
+            return false;
+        }
+
+        // A node with a depth is deeper than each of its prerequisites, which must have depths too.
+        if (arrays.depths[node] != noDepth) {
+            for (uint32_t edge = arrays.prerequisiteOffsets[node]; edge < arrays.prerequisiteOffsets[node + 1]; edge++) {
+                if (arrays.depths[arrays.prerequisites[edge]] >= arrays.depths[node]) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Replace the graph with a copy of arrays stored elsewhere.
+ *
+ * @param arrays - The location of every array.
+ */
+void PrerequisiteGraph::Assign(const Arrays& arrays) {
+    Clear();
+
+    ownedPrerequisiteOffsets.assign(arrays.prerequisiteOffsets, arrays.prerequisiteOffsets + arrays.nodeCount + 1);
+    ownedPrerequisites.assign(arrays.prerequisites, arrays.prerequisites + arrays.edgeCount);
+    ownedDependentOffsets.assign(arrays.dependentOffsets, arrays.dependentOffsets + arrays.nodeCount + 1);
+    ownedDependents.assign(arrays.dependents, arrays.dependents + arrays.edgeCount);
+    ownedDepths.assign(arrays.depths, arrays.depths + arrays.nodeCount);
+
+    useOwnedArrays();
+    buildClosureMatrix();
+}
+
+/**
+ * Remove every node from the graph and release its memory.
+ */
+void PrerequisiteGraph::Clear() {
+    vector<uint32_t>(1, 0).swap(ownedPrerequisiteOffsets);
+    vector<uint32_t>().swap(ownedPrerequisites);
+    vector<uint32_t>(1, 0).swap(ownedDependentOffsets);
+    vector<uint32_t>().swap(ownedDependents);
+    vector<uint32_t>().swap(ownedDepths);
+    vector<uint64_t>().swap(closureMatrix);
+    vector<uint64_t>().swap(dependentMatrix);
+    rowWords = 0;
+
+    useOwnedArrays();
+}
+
+/**
+ * Get the location of every array in the graph, such as to write them to a file.
+ * The offset arrays hold Size() + 1 elements.
+ */
+PrerequisiteGraph::Arrays PrerequisiteGraph::GetArrays() const {
+    return { prerequisiteOffsets, prerequisites, dependentOffsets, dependents, depths, nodeCount, prerequisiteOffsets[nodeCount] };
+}
+
+/**
+ * Get the number of nodes in the graph.
+ */
+size_t PrerequisiteGraph::Size() const {
+    return nodeCount;
+}
+
+/**
+ * Get a node's direct prerequisites, in the order that they were listed.
+ *
+ * @param node - The node.
+ */
+CourseCatalog::IdRange PrerequisiteGraph::Prerequisites(uint32_t node) const {
+    return { prerequisites + prerequisiteOffsets[node], prerequisites + prerequisiteOffsets[node + 1] };
+}
+
+/**
+ * Get the nodes that list a node as a direct prerequisite, in ascending order.
+ *
+ * @param node - The node.
+ */
+CourseCatalog::IdRange PrerequisiteGraph::Dependents(uint32_t node) const {
+    return { dependents + dependentOffsets[node], dependents + dependentOffsets[node + 1] };
+}
+
+/**
+ * Find a cycle of prerequisites with Tarjan's strongly connected components
+ * algorithm, iteratively, so that long chains cannot overflow the stack.
+ * Of every cyclic component, the one with the smallest node is reported, so
+ * the result does not depend on the order that the graph is traversed in.
+ *
+ * @param cycle - Receives the nodes of a shortest cycle through that smallest
+ *                node, each requiring the next, ending with the first node again.
+ * @return Whether or not the graph has a cycle.
+ */
+bool PrerequisiteGraph::FindCycle(vector<uint32_t>& cycle) const {
+    const uint32_t unvisited = UINT32_MAX;
+
+    cycle.clear();
+
+    // The order each node was first visited in, the smallest order reachable from it, and its component.
+    vector<uint32_t> visitOrder(nodeCount, unvisited);
+    vector<uint32_t> lowLink(nodeCount, 0);
+    vector<uint32_t> component(nodeCount, unvisited);
+
+    // The visited nodes that are not in a finished component yet.
+    vector<uint32_t> componentStack;
+
+    // The nodes being visited, and the next prerequisite edge of each to follow.
+    vector<pair<uint32_t, uint32_t>> callStack;
+
+    uint32_t nextOrder = 0;
+    uint32_t cycleStart = unvisited;
+
+    for (uint32_t root = 0; root < nodeCount; root++) {
+        if (visitOrder[root] != unvisited) {
+            continue;
+        }
+
+        visitOrder[root] = lowLink[root] = nextOrder++;
+        componentStack.push_back(root);
+        callStack.push_back({ root, prerequisiteOffsets[root] });
+
+        while (!callStack.empty()) {
+            uint32_t node = callStack.back().first;
+            uint32_t& edge = callStack.back().second;
+
+            // If the node has another prerequisite to follow...
+            if (edge < prerequisiteOffsets[node + 1]) {
+                uint32_t prerequisite = prerequisites[edge++];
+
+                if (visitOrder[prerequisite] == unvisited) {
+                    visitOrder[prerequisite] = lowLink[prerequisite] = nextOrder++;
+                    componentStack.push_back(prerequisite);
+                    callStack.push_back({ prerequisite, prerequisiteOffsets[prerequisite] });
+                }
+                // If the prerequisite is still on the component stack, it is an ancestor in the same component.
+                else if (component[prerequisite] == unvisited) {
+                    lowLink[node] = min(lowLink[node], visitOrder[prerequisite]);
+                }
+
+                continue;
+            }
+
+            callStack.pop_back();
+
+            // If the node is the root of a component, pop the whole component.
+            if (lowLink[node] == visitOrder[node]) {
+                uint32_t smallestNode = node;
+                size_t componentSize = 0;
+                uint32_t member;
+
+                do {
+                    member = componentStack.back();
+                    componentStack.pop_back();
+                    component[member] = node;
+                    smallestNode = min(smallestNode, member);
+                    componentSize++;
+                } while (member != node);
+
+                bool requiresItself = find(Prerequisites(node).begin(), Prerequisites(node).end(), node) != Prerequisites(node).end();
+
+                // A component is a cycle if it has several courses, or one that requires itself.
+                if ((componentSize > 1 || requiresItself) && smallestNode < cycleStart) {
+                    cycleStart = smallestNode;
+                }
+            }
+
+            if (!callStack.empty()) {
+                uint32_t parent = callStack.back().first;
+
+                lowLink[parent] = min(lowLink[parent], lowLink[node]);
+            }
+        }
+    }
+
+    if (cycleStart == unvisited) {
+        return false;
+    }
+
+    // Search breadth-first inside the component for the shortest way back to the first node.
+    vector<uint32_t> previous(nodeCount, unvisited);
+    deque<uint32_t> pendingNodes = { cycleStart };
+    uint32_t last = unvisited;
+
+    while (last == unvisited) {
+        uint32_t node = pendingNodes.front();
+        pendingNodes.pop_front();
+
+        for (uint32_t prerequisite : Prerequisites(node)) {
+            if (prerequisite == cycleStart) {
+                last = node;
+                break;
+            }
+
+            if (component[prerequisite] == component[cycleStart] && previous[prerequisite] == unvisited) {
+                previous[prerequisite] = node;
+                pendingNodes.push_back(prerequisite);
+            }
+        }
+    }
+
+    // Walk the path back from its last node, then put it in order.
+    for (uint32_t node = last; node != cycleStart; node = previous[node]) {
+        cycle.push_back(node);
+    }
+
+    cycle.push_back(cycleStart);
+    reverse(cycle.begin(), cycle.end());
+    cycle.push_back(cycleStart);
+
+    return true;
+}
+
+/**
+ * Find every node reachable from a node through one kind of edge. A cached
+ * row is read directly. Otherwise only the reached nodes are visited and
+ * sorted, so a node with few transitive neighbours is answered quickly even
+ * in a large graph.
+ *
+ * @param node - The node to start from.
+ * @param edgeOffsets - The offsets of each node's edges.
+ * @param edges - The edges to follow.
+ * @param matrix - The cached closure of every node, or an empty matrix.
+ * @param nodes - Receives the reached nodes in ascending order.
+ */
+void PrerequisiteGraph::reach(uint32_t node, const uint32_t* edgeOffsets, const uint32_t* edges,
+        const vector<uint64_t>& matrix, vector<uint32_t>& nodes) const {
+    nodes.clear();
+
+    // If the closure is cached, list the row's marked nodes in ascending order.
+    if (!matrix.empty()) {
+        const uint64_t* row = &matrix[node * rowWords];
+
+        for (size_t word = 0; word < rowWords; word++) {
+            for (uint64_t bits = row[word]; bits != 0; bits &= bits - 1) {
+                nodes.push_back(static_cast<uint32_t>(word * 64 + countTrailingZeros(bits)));
+            }
+        }
+
+        return;
+    }
+
+    // The marks of the nodes reached, one bit each.
+    vector<uint64_t> reached((Size() + 63) / 64, 0);
+
+    // Mark everything reachable through the edges, once each. The reached nodes are also the pending ones.
+    nodes.push_back(node);
+
+    for (size_t pending = 0; pending < nodes.size(); pending++) {
+        uint32_t currentNode = nodes[pending];
+
+        for (uint32_t i = edgeOffsets[currentNode]; i < edgeOffsets[currentNode + 1]; i++) {
+            uint32_t nextNode = edges[i];
+            uint64_t bit = uint64_t(1) << (nextNode % 64);
+
+            if ((reached[nextNode / 64] & bit) == 0) {
+                reached[nextNode / 64] |= bit;
+                nodes.push_back(nextNode);
+            }
+        }
+    }
+
+    // The starting node is only reached again if it is on a cycle.
+    nodes.erase(nodes.begin());
+
+    sort(nodes.begin(), nodes.end());
+}
+
+/**
+ * Find every transitive prerequisite of a node.
+ *
+ * @param node - The node.
+ * @param nodes - Receives the prerequisites in ascending order.
+ */
+void PrerequisiteGraph::Closure(uint32_t node, vector<uint32_t>& nodes) const {
+    reach(node, prerequisiteOffsets, prerequisites, closureMatrix, nodes);
+}
+
+/**
+ * Find every node that has a node as a transitive prerequisite.
+ *
+ * @param node - The node.
+ * @param nodes - Receives the dependents in ascending order.
+ */
+void PrerequisiteGraph::DependentClosure(uint32_t node, vector<uint32_t>& nodes) const {
+    reach(node, dependentOffsets, dependents, dependentMatrix, nodes);
+}
+
+/**
+ * Order the nodes so that every node comes after all of its prerequisites
+ * (Kahn's algorithm). Nodes become ready in ascending order, and each one
+ * is taken in the order it became ready.
+ *
+ * @param order - Receives the nodes in study order.
+ * @return Whether or not every node could be ordered. Nodes on or after a cycle cannot.
+ */
+bool PrerequisiteGraph::TopologicalOrder(vector<uint32_t>& order) const {
+    order.clear();
+    order.reserve(nodeCount);
+
+    // The number of each node's prerequisites that are not in the order yet.
+    vector<uint32_t> remaining(nodeCount);
+
+    for (uint32_t node = 0; node < nodeCount; node++) {
+        remaining[node] = prerequisiteOffsets[node + 1] - prerequisiteOffsets[node];
+
+        if (remaining[node] == 0) {
+            order.push_back(node);
+        }
+    }
+
+    // The order doubles as the queue of ready nodes.
+    for (size_t next = 0; next < order.size(); next++) {
+        for (uint32_t dependent : Dependents(order[next])) {
+            if (--remaining[dependent] == 0) {
+                order.push_back(dependent);
+            }
+        }
+    }
+
+    return order.size() == nodeCount;
+}
+
+/**
+ * Get the number of prerequisites in the longest chain before a node, which
+ * is the number of terms that must pass before it can be taken.
+ *
+ * @param node - The node.
+ * @return The depth, or noDepth if the node is on or after a cycle.
+ */
+uint32_t PrerequisiteGraph::Depth(uint32_t node) const {
+    return depths[node];
+}
+
+/**
+ * Plan the terms in which to take the goal nodes in buffers.goalNodes and
+ * all of their transitive prerequisites, taking at most a number of nodes
+ * per term and each node only after all of its prerequisites.
+ *
+ * The plan is a layered topological sort. Each term takes the ready nodes
+ * with the longest chain of needed nodes still after them, so that the
+ * chain that decides the number of terms is never held up. Sorting the
+ * needed nodes by their stored depths puts them in topological order, and
+ * the work and the buffers used only grow with the number of needed nodes.
+ *
+ * @param termLimit - The most nodes per term. It must be at least 1.
+ * @param buffers - The goal nodes, working arrays, and the plan on return.
+ * @return Whether or not a plan exists. It does not if a needed node is on or after a cycle.
+ */
+bool PrerequisiteGraph::Plan(size_t termLimit, PlanBuffers& buffers) const {
+    buffers.plannedNodes.clear();
+    buffers.termOffsets.assign(1, 0);
+
+    // Start a new visit mark, so the marks of earlier plans need not be cleared.
+    if (buffers.visitMarks.size() < nodeCount || ++buffers.visitMark == 0) {
+        buffers.visitMarks.assign(max(buffers.visitMarks.size(), nodeCount), 0);
+        buffers.neededPositions.resize(buffers.visitMarks.size());
+        buffers.visitMark = 1;
+    }
+
+    vector<uint32_t>& neededNodes = buffers.neededNodes;
+    uint32_t visitMark = buffers.visitMark;
+
+    // Collect the goals and every node that must be taken before them, once each.
+    neededNodes.clear();
+
+    for (uint32_t goal : buffers.goalNodes) {
+        if (buffers.visitMarks[goal] != visitMark) {
+            buffers.visitMarks[goal] = visitMark;
+            neededNodes.push_back(goal);
+        }
+    }
+
+    for (size_t next = 0; next < neededNodes.size(); next++) {
+        for (uint32_t prerequisite : Prerequisites(neededNodes[next])) {
+            if (buffers.visitMarks[prerequisite] != visitMark) {
+                buffers.visitMarks[prerequisite] = visitMark;
+                neededNodes.push_back(prerequisite);
+            }
+        }
+    }
+
+    // If a needed node can never be taken...
+    for (uint32_t node : neededNodes) {
+        if (depths[node] == noDepth) {
+            return false;
+        }
+    }
+
+    // Every prerequisite is shallower than the nodes that require it.
+    sort(neededNodes.begin(), neededNodes.end(), [this](uint32_t first, uint32_t second) {
+        return depths[first] != depths[second] ? depths[first] < depths[second] : first < second;
+    });
+
+    size_t neededCount = neededNodes.size();
+
+    for (size_t position = 0; position < neededCount; position++) {
+        buffers.neededPositions[neededNodes[position]] = static_cast<uint32_t>(position);
+    }
+
+    // Find each needed node's longest chain of needed nodes, itself included, from the deepest node up.
+    // Each node's needed dependents are counted on the way, since only its prerequisites are cheap to list.
+    vector<uint32_t>& heights = buffers.heights;
+    vector<uint32_t>& dependentOffsets = buffers.dependentOffsets;
+
+    heights.assign(neededCount, 1);
+    dependentOffsets.assign(neededCount + 1, 0);
+    buffers.remainingPrerequisites.resize(neededCount);
+
+    for (size_t position = neededCount; position-- > 0;) {
+        CourseCatalog::IdRange nodePrerequisites = Prerequisites(neededNodes[position]);
+
+        buffers.remainingPrerequisites[position] = static_cast<uint32_t>(nodePrerequisites.size());
+
+        for (uint32_t prerequisite : nodePrerequisites) {
+            uint32_t prerequisitePosition = buffers.neededPositions[prerequisite];
+
+            heights[prerequisitePosition] = max(heights[prerequisitePosition], heights[position] + 1);
+            dependentOffsets[prerequisitePosition + 1]++;
+        }
+    }
+
+    for (size_t position = 0; position < neededCount; position++) {
+        dependentOffsets[position + 1] += dependentOffsets[position];
+    }
+
+    // List the needed dependents of each needed node, by position. The heap reuses its buffer as the next free slots.
+    vector<uint32_t>& readyPositions = buffers.readyPositions;
+
+    buffers.dependents.resize(dependentOffsets[neededCount]);
+    readyPositions.assign(dependentOffsets.begin(), dependentOffsets.end() - 1);
+
+    for (size_t position = 0; position < neededCount; position++) {
+        for (uint32_t prerequisite : Prerequisites(neededNodes[position])) {
+            buffers.dependents[readyPositions[buffers.neededPositions[prerequisite]]++] = static_cast<uint32_t>(position);
+        }
+    }
+
+    // The heap's top is the ready node with the longest chain after it, and then the shallowest, smallest node.
+    auto takesLater = [&heights](uint32_t first, uint32_t second) {
+        return heights[first] != heights[second] ? heights[first] < heights[second] : first > second;
+    };
+
+    readyPositions.clear();
+
+    for (size_t position = 0; position < neededCount; position++) {
+        if (buffers.remainingPrerequisites[position] == 0) {
+            readyPositions.push_back(static_cast<uint32_t>(position));
+        }
+    }
+
+    make_heap(readyPositions.begin(), readyPositions.end(), takesLater);
+
+    // Fill one term at a time. Nodes that become ready wait for the next term.
+    vector<uint32_t>& plannedNodes = buffers.plannedNodes;
+
+    while (!readyPositions.empty()) {
+        size_t termStart = plannedNodes.size();
+
+        for (size_t taken = 0; taken < termLimit && !readyPositions.empty(); taken++) {
+            pop_heap(readyPositions.begin(), readyPositions.end(), takesLater);
+            plannedNodes.push_back(readyPositions.back());
+            readyPositions.pop_back();
+        }
+
+        for (size_t i = termStart; i < plannedNodes.size(); i++) {
+            uint32_t position = plannedNodes[i];
+
+            for (uint32_t j = dependentOffsets[position]; j < dependentOffsets[position + 1]; j++) {
+                uint32_t dependent = buffers.dependents[j];
+
+                if (--buffers.remainingPrerequisites[dependent] == 0) {
+                    readyPositions.push_back(dependent);
+                    push_heap(readyPositions.begin(), readyPositions.end(), takesLater);
+                }
+            }
+
+            // Record the node itself instead of its position.
+            plannedNodes[i] = neededNodes[position];
+        }
+
+        // List each term in ascending order.
+        sort(plannedNodes.begin() + termStart, plannedNodes.end());
+        buffers.termOffsets.push_back(static_cast<uint32_t>(plannedNodes.size()));
+    }
+
+    return true;
+}
+
+//============================================================================
+// MappedFile class definition
+//============================================================================
+
+/**
+ * Define a class that maps a whole file into memory so that it can be
+ * parsed in place without copying it line by line.
+ *
+ * The mapping is private (copy-on-write), so the parser may normalize
+ * fields in the buffer without modifying the file on disk.
+ */
+class MappedFile {
+
+private:
+    char* data;
+    size_t size;
+    bool mapped;
+    vector<char> buffer;
+
+public:
+    MappedFile();
+    virtual ~MappedFile();
+    bool Open(const string& path, bool sequential = true);
+    void Close();
+    char* Data();
+    size_t Size();
+};
+
+/**
+ * Default constructor
+ */
+MappedFile::MappedFile() {
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
+
+/**
+ * Destructor
+ */
+MappedFile::~MappedFile() {
+    Close();
+}
+
+/**
+ * Map the specified file into memory.
+ *
+ * @param path - The path of the file to map.
+ * @param sequential - Whether the file is read once from front to back, as a csv file is. A snapshot is read at random.
+ * @return Whether or not the file could be opened.
+ */
+bool MappedFile::Open(const string& path, bool sequential) {
+    PLANNER_STAT_PHASE(readPhase);
+
+    // Release any previously mapped file.
+    Close();
+
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+
+    // If the file could not be opened...
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStatus;
+
+    // If the file size could not be determined or it is not a regular file...
+    if (fstat(fd, &fileStatus) != 0 || !S_ISREG(fileStatus.st_mode)) {
+        close(fd);
+
+        return false;
+    }
+
+    size = static_cast<size_t>(fileStatus.st_size);
+
+    // An empty file cannot be mapped, but it is still a valid file.
+    if (size > 0) {
+        void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+        if (address == MAP_FAILED) {
+            close(fd);
+            size = 0;
+
+            return false;
+        }
+
+        data = static_cast<char*>(address);
+        mapped = true;
+
+        // A csv file is read from front to back exactly once.
+        if (sequential) {
+            madvise(address, size, MADV_SEQUENTIAL);
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+
+    return true;
+#else
+    // Reading the whole file has no access pattern to advise.
+    (void)sequential;
+
+    // Fall back to reading the whole file into one buffer where mmap is not available.
+    ifstream file(path, ios::binary);
+
+    if (!file.is_open()) {
+        return false;
+    }
+
+    buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+
+    return true;
+#endif
+}
+
+/**
+ * Unmap the file and release its memory.
+ */
+void MappedFile::Close() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(data, size);
+    }
+#endif
+
+    buffer.clear();
+    buffer.shrink_to_fit();
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
+
+/**
+ * Get the first byte of the mapped file.
+ */
+char* MappedFile::Data() {
+    return data;
+}
+
+/**
+ * Get the number of bytes in the mapped file.
+ */
+size_t MappedFile::Size() {
+    return size;
+}
+
+//============================================================================
+// Catalog Files class definition
+//============================================================================
+
+/**
+ * Define a class that maps the csv files of a catalog and parses them into
+ * one parsed catalog. A catalog is either one csv file or a directory of
+ * them, such as one file per department. Each file of a directory is a
+ * shard: the shards are mapped and parsed at the same time, up to the
+ * thread count, and their courses are joined in order of their file names,
+ * so prerequisites are checked across every shard as if the files were one.
+ */
+class CatalogFiles {
+
+private:
+    // The mapped files. The parsed fields refer to them until they are closed.
+    deque<MappedFile> files;
+
+public:
+    bool Open(const string& csvPath, ParsedCatalog& parsedCatalog, unsigned threadCount);
+    void Close();
+    static bool ListFiles(const string& csvPath, vector<string>& paths);
+};
+
+/**
+ * List the csv files of a catalog: the path itself if it is a file, or
+ * every file ending in .csv in it, in name order, if it is a directory.
+ *
+ * @param csvPath - The path of a csv file or a directory of csv files.
+ * @param paths - Receives the path of each csv file.
+ * @return Whether or not the catalog has a csv file.
+ */
+bool CatalogFiles::ListFiles(const string& csvPath, vector<string>& paths) {
+    paths.clear();
+
+    error_code error;
+
+    if (!filesystem::is_directory(csvPath, error)) {
+        paths.push_back(csvPath);
+
+        return true;
+    }
+
+    for (const filesystem::directory_entry& entry : filesystem::directory_iterator(csvPath, error)) {
+        string extension = entry.path().extension().string();
+
+        toUpperCase(extension);
+
+        if (extension == ".CSV" && entry.is_regular_file(error)) {
+            paths.push_back(entry.path().string());
+        }
+    }
+
+    sort(paths.begin(), paths.end());
+
+    return !paths.empty();
+}
+
+/**
+ * Map and parse every csv file of a catalog. A single file is parsed on
+ * several threads. The files of a directory are each parsed on one thread.
+ *
+ * @param csvPath - The path of a csv file or a directory of csv files.
+ * @param parsedCatalog - Receives the courses of every file, in order.
+ * @param threadCount - The most threads to parse on.
+ * @return Whether or not every file could be opened.
+ */
+bool CatalogFiles::Open(const string& csvPath, ParsedCatalog& parsedCatalog, unsigned threadCount) {
+    Close();
+
+    vector<string> paths;
+
+    if (!ListFiles(csvPath, paths)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        files.emplace_back();
+    }
+
+    if (paths.size() == 1) {
+        if (!files[0].Open(paths[0])) {
+            return false;
+        }
+
+        parseCoursesInParallel(files[0].Data(), files[0].Size(), parsedCatalog, threadCount);
+
+        return true;
+    }
+
+    PLANNER_STAT_PHASE(parsePhase);
+
+    vector<ParsedCatalog> shards(paths.size());
+    atomic<size_t> nextShard(0);
+    atomic<bool> opened(true);
+
+    // Each thread maps and parses the next shard until there are none left.
+    runInParallel(min<size_t>(max(threadCount, 1u), paths.size()), [&](size_t) {
+        for (size_t i = nextShard++; i < paths.size(); i = nextShard++) {
+            if (!files[i].Open(paths[i])) {
+                opened = false;
+
+                continue;
+            }
+
+            PLANNER_STAT_ADD(bytes, files[i].Size());
+
+            parseCourses(files[i].Data(), files[i].Size(), shards[i]);
+        }
+    });
+
+    if (!opened) {
+        return false;
+    }
+
+    joinParsedCatalogs(shards, parsedCatalog, threadCount);
+
+    return true;
+}
+
+/**
+ * Unmap every file. The parsed fields that refer to them are no longer valid.
+ */
+void CatalogFiles::Close() {
+    files.clear();
+}
+
+//============================================================================
+// Catalog Snapshot definitions
+//============================================================================
+
+// Identifies a catalog snapshot file and the version of its layout.
+static const char snapshotMagic[8] = { 'A', 'B', 'C', 'U', 'S', 'N', 'A', 'P' };
+static const uint32_t snapshotVersion = 5;
+
+// Define a structure to hold what identifies the contents of one csv file:
+// its size, modification time, device and inode, and a hash of its bytes.
+// Every field is a fixed-size integer, so a stamp is stored as raw bytes.
+struct FileStamp {
+    uint64_t size;
+    int64_t modifiedSeconds;
+    int64_t modifiedNanoseconds;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t contentHash;
+
+    // Default constructor.
+    FileStamp() {
+        size = 0;
+        modifiedSeconds = 0;
+        modifiedNanoseconds = 0;
+        device = 0;
+        inode = 0;
+        contentHash = 0;
+    }
+};
+
+// Define a structure to hold the stamp of a catalog: the canonical path of
+// its csv file or directory, then the name and stamp of each csv file in the
+// order they are read. A snapshot records the stamp of the catalog it was
+// built from, and is stale once any of it changes, so a different file, a
+// renamed or swapped shard, or a rewrite that keeps the size and time all
+// make it stale.
+struct CatalogStamp {
+    string record;
+
+    bool operator==(const CatalogStamp& other) const {
+        return record == other.record;
+    }
+};
+
+// Define a structure to hold the header at the start of a snapshot file.
+//
+// The header is followed by the stamp of the catalog, then the catalog's entries, text, prerequisite IDs
+// and hash table slots, then the frozen index's keys, ranks and course IDs,
+// then the name index's word text, word offsets, posting offsets, postings
+// and hash table slots, then the prerequisite graph's prerequisite offsets,
+// prerequisites, dependent offsets, dependents and depths, each starting on
+// an 8-byte boundary. Every array is stored exactly as it
+// is laid out in memory, so the file is read in place once it is mapped.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+
+    // The load options that the csv file was checked with.
+    uint32_t optionFlags;
+
+    // The length of the stamp of the catalog that the snapshot was built from, which follows the header.
+    uint64_t sourceSize;
+
+    // The checksum of every array after the header.
+    uint64_t checksum;
+
+    // The record sizes, so that a snapshot from a different build is rejected.
+    uint64_t entrySize;
+    uint64_t keySize;
+
+    // The number of elements in each array.
+    uint64_t entryCount;
+    uint64_t textSize;
+    uint64_t prerequisiteCount;
+    uint64_t slotCount;
+    uint64_t indexSize;
+    uint64_t wordTextSize;
+    uint64_t wordCount;
+    uint64_t postingCount;
+    uint64_t wordSlotCount;
+    uint64_t edgeCount;
+};
+
+// Define a structure to hold one array of a snapshot file.
+struct SnapshotSection {
+    const void* data;
+    size_t size;
+};
+
+// The number of arrays in a snapshot file.
+static const size_t snapshotSectionCount = 17;
+
+/**
+ * Hash the contents of a file, reading it in blocks.
+ *
+ * @param path - The path of the file.
+ * @param hash - Receives the hash.
+ * @return Whether or not the file could be read.
+ */
+bool hashFileContents(const string& path, uint64_t& hash) {
+    FILE* file = fopen(path.c_str(), "rb");
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    vector<char> block(1 << 20);
+    size_t readSize;
+
+    hash = 0;
+
+    while ((readSize = fread(block.data(), 1, block.size(), file)) > 0) {
+        hash = updateChecksum(hash, block.data(), readSize);
+    }
+
+    bool read = (ferror(file) == 0);
+
+    fclose(file);
+
+    return read;
+}
+
+/**
+ * Get the stamp of a csv file, which hashes all of its contents.
+ *
+ * @param path - The path of the file.
+ * @param stamp - The stamp to fill in.
+ * @return Whether or not the file exists and could be read.
+ */
+bool readFileStamp(const string& path, FileStamp& stamp) {
+#ifndef _WIN32
+    struct stat fileStatus;
+
+    if (stat(path.c_str(), &fileStatus) != 0) {
+        return false;
+    }
+
+    stamp.size = static_cast<uint64_t>(fileStatus.st_size);
+    stamp.modifiedSeconds = static_cast<int64_t>(fileStatus.st_mtime);
+
+#if defined(__APPLE__)
+    stamp.modifiedNanoseconds = static_cast<int64_t>(fileStatus.st_mtimespec.tv_nsec);
+#elif defined(__linux__)
+    stamp.modifiedNanoseconds = static_cast<int64_t>(fileStatus.st_mtim.tv_nsec);
+#else
+    stamp.modifiedNanoseconds = 0;
+#endif
+#else
+    struct _stat64 fileStatus;
+
+    if (_stat64(path.c_str(), &fileStatus) != 0) {
+        return false;
+    }
+
+    stamp.size = static_cast<uint64_t>(fileStatus.st_size);
+    stamp.modifiedSeconds = static_cast<int64_t>(fileStatus.st_mtime);
+    stamp.modifiedNanoseconds = 0;
+#endif
+
+    stamp.device = static_cast<uint64_t>(fileStatus.st_dev);
+    stamp.inode = static_cast<uint64_t>(fileStatus.st_ino);
+
+    return hashFileContents(path, stamp.contentHash);
+}
+
+/**
+ * Read the stamp of a catalog: its canonical path, and the name and stamp
+ * of every csv file in it.
+ *
+ * @param csvPath - The path of a csv file or a directory of csv files.
+ * @param stamp - Receives the stamp.
+ * @return Whether or not every file's stamp could be read.
+ */
+bool readCatalogStamp(const string& csvPath, CatalogStamp& stamp) {
+    error_code error;
+    filesystem::path canonicalPath = filesystem::canonical(csvPath, error);
+    vector<string> paths;
+
+    if (error || !CatalogFiles::ListFiles(csvPath, paths)) {
+        return false;
+    }
+
+    stamp.record = canonicalPath.string();
+    stamp.record.push_back('\0');
+
+    for (const string& path : paths) {
+        FileStamp fileStamp;
+
+        if (!readFileStamp(path, fileStamp)) {
+            return false;
+        }
+
+        // A shard is known by its name in the directory. A single file's name is already in its path.
+        stamp.record += filesystem::path(path).filename().string();
+        stamp.record.push_back('\0');
+        stamp.record.append(reinterpret_cast<const char*>(&fileStamp), sizeof(fileStamp));
+    }
+
+    return true;
+}
+
+/**
+ * Round a size up to the next multiple of 8 bytes.
+ *
+ * @param size - The size to round.
+ */
+size_t alignSnapshotSize(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+/**
+ * Add bytes to a checksum, eight at a time.
+ *
+ * @param checksum - The checksum of the bytes so far.
+ * @param data - The bytes to add.
+ * @param size - The number of bytes to add.
+ * @return The updated checksum.
+ */
+uint64_t updateChecksum(uint64_t checksum, const char* data, size_t size) {
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+
+        memcpy(&word, data + i, 8);
+        checksum = (checksum ^ word) * multiplier;
+        checksum ^= checksum >> 29;
+    }
+
+    // Mix in the remaining bytes together with their count.
+    uint64_t tail = size - i;
+
+    for (; i < size; i++) {
+        tail = (tail << 8) | static_cast<unsigned char>(data[i]);
+    }
+
+    checksum = (checksum ^ tail) * multiplier;
+    checksum ^= checksum >> 29;
+
+    return checksum;
+}
+
+/**
+ * Fill in the arrays of a snapshot in the order that they are stored.
+ *
+ * @param header - The snapshot's header, with its element counts.
+ * @param sections - The array to fill in. Only the sizes are set.
+ */
+void getSnapshotSectionSizes(const SnapshotHeader& header, SnapshotSection sections[]) {
+    sections[0].size = header.entryCount * header.entrySize;
+    sections[1].size = header.textSize;
+    sections[2].size = header.prerequisiteCount * sizeof(uint32_t);
+    sections[3].size = header.slotCount * sizeof(uint32_t);
+    sections[4].size = (header.indexSize + 1) * header.keySize;
+    sections[5].size = (header.indexSize + 1) * sizeof(uint32_t);
+    sections[6].size = header.indexSize * sizeof(uint32_t);
+    sections[7].size = header.wordTextSize;
+    sections[8].size = (header.wordCount + 1) * sizeof(uint32_t);
+    sections[9].size = (header.wordCount + 1) * sizeof(uint32_t);
+    sections[10].size = header.postingCount * sizeof(uint32_t);
+    sections[11].size = header.wordSlotCount * sizeof(uint32_t);
+    sections[12].size = (header.indexSize + 1) * sizeof(uint32_t);
+    sections[13].size = header.edgeCount * sizeof(uint32_t);
+    sections[14].size = (header.indexSize + 1) * sizeof(uint32_t);
+    sections[15].size = header.edgeCount * sizeof(uint32_t);
+    sections[16].size = header.indexSize * sizeof(uint32_t);
+}
+
+/**
+ * Write a loaded catalog, its frozen and name indexes and its prerequisite
+ * graph to a snapshot file.
+ * The file is written under a temporary name and then renamed, so a reader
+ * never sees a partly written snapshot.
+ *
+ * @param path - The path of the snapshot file.
+ * @param source - The stamp of the csv files the catalog was loaded from.
+ * @param optionFlags - The load options that the csv file was checked with.
+ * @param catalogArrays - The catalog's arrays.
+ * @param indexArrays - The frozen index's arrays.
+ * @param nameArrays - The name index's arrays.
+ * @param graphArrays - The prerequisite graph's arrays. Its nodes are the frozen index's ranks.
+ * @return Whether or not the snapshot was written.
+ */
+bool writeSnapshot(const string& path, const CatalogStamp& source, uint32_t optionFlags,
+        const CourseCatalog::Arrays& catalogArrays, const FrozenIndex::Arrays& indexArrays,
+        const NameIndex::Arrays& nameArrays, const PrerequisiteGraph::Arrays& graphArrays) {
+    // The graph's nodes must be the index's ranks, since the snapshot only records one count for both.
+    if (graphArrays.nodeCount != indexArrays.size) {
+        return false;
+    }
+
+    SnapshotHeader header;
+
+    // Clear the padding too, so that identical catalogs give identical files.
+    memset(static_cast<void*>(&header), 0, sizeof(header));
+    memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+
+    header.version = snapshotVersion;
+    header.optionFlags = optionFlags;
+    header.sourceSize = source.record.size();
+    header.entrySize = CourseCatalog::EntrySize();
+    header.keySize = sizeof(CourseKey);
+    header.entryCount = catalogArrays.entryCount;
+    header.textSize = catalogArrays.textSize;
+    header.prerequisiteCount = catalogArrays.prerequisiteCount;
+    header.slotCount = catalogArrays.slotCount;
+    header.indexSize = indexArrays.size;
+    header.wordTextSize = nameArrays.wordTextSize;
+    header.wordCount = nameArrays.wordCount;
+    header.postingCount = nameArrays.postingCount;
+    header.wordSlotCount = nameArrays.slotCount;
+    header.edgeCount = graphArrays.edgeCount;
+
+    SnapshotSection sections[snapshotSectionCount];
+
+    getSnapshotSectionSizes(header, sections);
+
+    sections[0].data = catalogArrays.entries;
+    sections[1].data = catalogArrays.text;
+    sections[2].data = catalogArrays.prerequisiteIds;
+    sections[3].data = catalogArrays.slots;
+    sections[4].data = indexArrays.keys;
+    sections[5].data = indexArrays.ranks;
+    sections[6].data = indexArrays.courseIds;
+    sections[7].data = nameArrays.wordText;
+    sections[8].data = nameArrays.wordOffsets;
+    sections[9].data = nameArrays.postingOffsets;
+    sections[10].data = nameArrays.postings;
+    sections[11].data = nameArrays.slots;
+    sections[12].data = graphArrays.prerequisiteOffsets;
+    sections[13].data = graphArrays.prerequisites;
+    sections[14].data = graphArrays.dependentOffsets;
+    sections[15].data = graphArrays.dependents;
+    sections[16].data = graphArrays.depths;
+
+    // Checksum the stamp and each array separately, the same way they are checked when read.
+    const char padding[8] = { 0 };
+
+    header.checksum = updateChecksum(header.checksum, source.record.data(), source.record.size());
+
+    for (const SnapshotSection& section : sections) {
+        header.checksum = updateChecksum(header.checksum, static_cast<const char*>(section.data), section.size);
+    }
+
+    string temporaryPath = path + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    size_t sourcePaddingSize = alignSnapshotSize(source.record.size()) - source.record.size();
+
+    if (written && !source.record.empty()) {
+        written = fwrite(source.record.data(), source.record.size(), 1, file) == 1;
+    }
+
+    if (written && sourcePaddingSize > 0) {
+        written = fwrite(padding, sourcePaddingSize, 1, file) == 1;
+    }
+
+    for (const SnapshotSection& section : sections) {
+        size_t paddingSize = alignSnapshotSize(section.size) - section.size;
+
+        if (written && section.size > 0) {
+            written = fwrite(section.data, section.size, 1, file) == 1;
+        }
+
+        if (written && paddingSize > 0) {
+            written = fwrite(padding, paddingSize, 1, file) == 1;
+        }
+    }
+
+    written = (fclose(file) == 0) && written;
+
+#ifdef _WIN32
+    // Renaming does not replace an existing file on Windows.
+    remove(path.c_str());
+#endif
+
+    if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        remove(temporaryPath.c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Check a mapped snapshot file and find its arrays.
+ *
+ * @param data - The first byte of the snapshot file. It must be 8-byte aligned.
+ * @param size - The number of bytes in the snapshot file.
+ * @param source - The current stamp of the catalog's csv files.
+ * @param optionFlags - The load options that the csv file must have been checked with.
+ * @param catalogArrays - The catalog's arrays, filled in if the snapshot is usable.
+ * @param indexArrays - The frozen index's arrays, filled in if the snapshot is usable.
+ * @param nameArrays - The name index's arrays, filled in if the snapshot is usable.
+ * @param graphArrays - The prerequisite graph's arrays, filled in if the snapshot is usable.
+ * @return Whether or not the snapshot is intact, refers only within its arrays, and is up to date with the csv file.
+ */
+bool readSnapshot(const char* data, size_t size, const CatalogStamp& source, uint32_t optionFlags,
+        CourseCatalog::Arrays& catalogArrays, FrozenIndex::Arrays& indexArrays,
+        NameIndex::Arrays& nameArrays, PrerequisiteGraph::Arrays& graphArrays) {
+    if (size < sizeof(SnapshotHeader)) {
+        return false;
+    }
+
+    SnapshotHeader header;
+
+    memcpy(static_cast<void*>(&header), data, sizeof(header));
+
+    // If the file is not a snapshot from this build, or the csv file or options have changed since...
+    if (memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0
+            || header.version != snapshotVersion
+            || header.entrySize != CourseCatalog::EntrySize()
+            || header.keySize != sizeof(CourseKey)
+            || header.optionFlags != optionFlags
+            || header.sourceSize != source.record.size()
+            || header.sourceSize > size - sizeof(SnapshotHeader)
+            || memcmp(data + sizeof(SnapshotHeader), source.record.data(), source.record.size()) != 0) {
+        return false;
+    }
+
+    // Every count is at most the file size, so the section sizes below cannot overflow.
+    if (header.entryCount > size || header.textSize > size || header.prerequisiteCount > size
+            || header.slotCount > size || header.indexSize > size || header.wordTextSize > size
+            || header.wordCount > size || header.postingCount > size || header.wordSlotCount > size
+            || header.edgeCount > size) {
+        return false;
+    }
+
+    SnapshotSection sections[snapshotSectionCount];
+    size_t offset = sizeof(SnapshotHeader) + alignSnapshotSize(source.record.size());
+
+    if (offset > size) {
+        return false;
+    }
+
+    getSnapshotSectionSizes(header, sections);
+
+    // Find each array, and check that the file holds all of them and nothing else.
+    for (SnapshotSection& section : sections) {
+        if (section.size > size - offset) {
+            return false;
+        }
+
+        section.data = data + offset;
+        offset += alignSnapshotSize(section.size);
+
+        if (offset > size) {
+            return false;
+        }
+    }
+
+    if (offset != size) {
+        return false;
+    }
+
+    // The hash tables must have power-of-two sizes, as if the catalog and name index had built them.
+    if ((header.slotCount != 0 && (header.slotCount & (header.slotCount - 1)) != 0)
+            || (header.wordSlotCount != 0 && (header.wordSlotCount & (header.wordSlotCount - 1)) != 0)) {
+        return false;
+    }
+
+    uint64_t checksum = updateChecksum(0, source.record.data(), source.record.size());
+
+    for (const SnapshotSection& section : sections) {
+        checksum = updateChecksum(checksum, static_cast<const char*>(section.data), section.size);
+    }
+
+    // If the snapshot has been damaged...
+    if (checksum != header.checksum) {
+        return false;
+    }
+
+    catalogArrays.entries = sections[0].data;
+    catalogArrays.entryCount = header.entryCount;
+    catalogArrays.text = static_cast<const char*>(sections[1].data);
+    catalogArrays.textSize = header.textSize;
+    catalogArrays.prerequisiteIds = static_cast<const uint32_t*>(sections[2].data);
+    catalogArrays.prerequisiteCount = header.prerequisiteCount;
+    catalogArrays.slots = static_cast<const uint32_t*>(sections[3].data);
+    catalogArrays.slotCount = header.slotCount;
+
+    indexArrays.keys = static_cast<const CourseKey*>(sections[4].data);
+    indexArrays.ranks = static_cast<const uint32_t*>(sections[5].data);
+    indexArrays.courseIds = static_cast<const uint32_t*>(sections[6].data);
+    indexArrays.size = header.indexSize;
+
+    nameArrays.wordText = static_cast<const char*>(sections[7].data);
+    nameArrays.wordTextSize = header.wordTextSize;
+    nameArrays.wordOffsets = static_cast<const uint32_t*>(sections[8].data);
+    nameArrays.postingOffsets = static_cast<const uint32_t*>(sections[9].data);
+    nameArrays.wordCount = header.wordCount;
+    nameArrays.postings = static_cast<const uint32_t*>(sections[10].data);
+    nameArrays.postingCount = header.postingCount;
+    nameArrays.slots = static_cast<const uint32_t*>(sections[11].data);
+    nameArrays.slotCount = header.wordSlotCount;
+
+    graphArrays.prerequisiteOffsets = static_cast<const uint32_t*>(sections[12].data);
+    graphArrays.prerequisites = static_cast<const uint32_t*>(sections[13].data);
+    graphArrays.dependentOffsets = static_cast<const uint32_t*>(sections[14].data);
+    graphArrays.dependents = static_cast<const uint32_t*>(sections[15].data);
+    graphArrays.depths = static_cast<const uint32_t*>(sections[16].data);
+    graphArrays.nodeCount = header.indexSize;
+    graphArrays.edgeCount = header.edgeCount;
+
+    // The checksum only finds damage. A crafted snapshot must also be checked to refer only within its arrays.
+    return CourseCatalog::CheckArrays(catalogArrays)
+        && FrozenIndex::CheckArrays(indexArrays, catalogArrays.entryCount)
+        && NameIndex::CheckArrays(nameArrays, indexArrays.size)
+        && PrerequisiteGraph::CheckArrays(graphArrays);
+}
+
+//============================================================================
+// Response Cache class definition
+//============================================================================
+
+/**
+ * Define a class that keeps the rendered output of recent course lookups,
+ * so that popular courses are printed with one copy instead of being found
+ * and formatted again. A lookup of a course that does not exist is kept
+ * too, as a negative entry holding its "not found" message.
+ *
+ * The cache is set-associative: a key's hash picks a set of a few entries,
+ * and a full set evicts with the CLOCK algorithm, passing over entries
+ * whose reference bit is set and clearing it. Each entry stores its key
+ * and response inline in a fixed number of words, so the cache never
+ * allocates once it is built, and keys or responses too long for an entry
+ * are not cached.
+ *
+ * A hit takes no lock and writes no shared memory except to set a clear
+ * reference bit. Entries are read under a sequence lock: the reader copies
+ * the response and keeps it only if the entry's sequence number did not
+ * change meanwhile. Only adding an entry takes the lock.
+ */
+class ResponseCache {
+
+private:
+    // The entries in each set, and the 64-bit words of each entry.
+    static constexpr size_t ways = 4;
+    static constexpr size_t entryWords = 64;
+
+    // An entry holds three header words, then its key padded to whole words, then its response.
+    // The headers are the key's hash, the generation and key length, and the found flag and response length.
+    static constexpr size_t headerWords = 3;
+    static constexpr size_t maxKeyLength = 32;
+    static constexpr size_t keyWords = maxKeyLength / 8;
+    static constexpr size_t responseWords = entryWords - headerWords - keyWords;
+    static constexpr size_t maxResponseLength = responseWords * 8;
+
+    // Define a structure to hold one cached response.
+    struct Entry {
+        // Odd while the entry is being written.
+        atomic<uint32_t> sequence;
+        atomic<uint8_t> referenced;
+        atomic<uint64_t> words[entryWords];
+    };
+
+    unique_ptr<Entry[]> entries;
+    size_t setCount;
+
+    // The next entry that the CLOCK algorithm considers in each set. It is only used while adding.
+    unique_ptr<uint8_t[]> hands;
+
+    // Entries added in an earlier generation are empty. Clear() starts a new generation.
+    atomic<uint32_t> generation;
+    atomic<bool> filled;
+
+    mutex addMutex;
+
+    static void packKey(string_view key, uint64_t* packedKey);
+    bool holds(const Entry& entry, uint64_t hash, uint64_t identity, const uint64_t* packedKey) const;
+
+public:
+    explicit ResponseCache(size_t entryCount);
+    bool Print(string_view key, ostream& out);
+    void Add(string_view key, const string& response, bool found);
+    void Clear();
+};
+
+/**
+ * Build an empty cache.
+ *
+ * @param entryCount - The least number of entries to hold. It is rounded up to a power of two.
+ */
+ResponseCache::ResponseCache(size_t entryCount) {
+    setCount = 1;
+
+    while (setCount * ways < entryCount) {
+        setCount *= 2;
+    }
+
+    entries.reset(new Entry[setCount * ways]);
+    hands.reset(new uint8_t[setCount]());
+
+    for (size_t i = 0; i < setCount * ways; i++) {
+        entries[i].sequence.store(0, memory_order_relaxed);
+        entries[i].referenced.store(0, memory_order_relaxed);
+
+        for (atomic<uint64_t>& word : entries[i].words) {
+            word.store(0, memory_order_relaxed);
+        }
+    }
+
+    // Every entry is in generation zero, so it starts empty.
+    generation.store(1, memory_order_relaxed);
+    filled.store(false, memory_order_relaxed);
+}
+
+/**
+ * Copy a key into words, padded with zeros, as it is stored in an entry.
+ *
+ * @param key - A key of at most maxKeyLength characters.
+ * @param packedKey - Receives keyWords words.
+ */
+void ResponseCache::packKey(string_view key, uint64_t* packedKey) {
+    memset(packedKey, 0, keyWords * sizeof(uint64_t));
+    memcpy(packedKey, key.data(), key.size());
+}
+
+/**
+ * Determine whether an entry holds a key in the current generation. The
+ * answer is only reliable if the entry's sequence number did not change.
+ *
+ * @param entry - The entry.
+ * @param hash - The key's hash.
+ * @param identity - The current generation and the key's length, as stored in the second header word.
+ * @param packedKey - The key, packed by packKey.
+ */
+bool ResponseCache::holds(const Entry& entry, uint64_t hash, uint64_t identity, const uint64_t* packedKey) const {
+    if (entry.words[0].load(memory_order_relaxed) != hash || entry.words[1].load(memory_order_relaxed) != identity) {
+        return false;
+    }
+
+    for (size_t i = 0; i < keyWords; i++) {
+        if (entry.words[headerWords + i].load(memory_order_relaxed) != packedKey[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Print the cached response for a key, and mark it as recently used.
+ * Many threads may print at once, and while another thread adds.
+ *
+ * @param key - The key of the response, such as an upper-case course number.
+ * @param out - The stream to print to.
+ * @return Whether or not the response was cached. Nothing is printed if not.
+ */
+bool ResponseCache::Print(string_view key, ostream& out) {
+    if (key.size() > maxKeyLength) {
+        PLANNER_STAT_ADD(cacheMisses, 1);
+
+        return false;
+    }
+
+    uint64_t packedKey[keyWords];
+    uint64_t hash = std::hash<string_view>()(key);
+    uint64_t identity = (uint64_t(generation.load(memory_order_relaxed)) << 32) | key.size();
+    Entry* set = &entries[(hash & (setCount - 1)) * ways];
+
+    packKey(key, packedKey);
+
+    for (size_t way = 0; way < ways; way++) {
+        Entry& entry = set[way];
+        uint32_t sequence = entry.sequence.load(memory_order_acquire);
+
+        if ((sequence & 1) != 0 || !holds(entry, hash, identity, packedKey)) {
+            continue;
+        }
+
+        uint64_t lengths = entry.words[2].load(memory_order_relaxed);
+        size_t responseLength = static_cast<size_t>(lengths & 0xFFFFFFFF);
+        uint64_t response[responseWords];
+
+        for (size_t i = 0; i < (responseLength + 7) / 8 && i < responseWords; i++) {
+            response[i] = entry.words[headerWords + keyWords + i].load(memory_order_relaxed);
+        }
+
+        // If the entry was rewritten while it was read, the copy cannot be trusted.
+        atomic_thread_fence(memory_order_acquire);
+
+        if (entry.sequence.load(memory_order_relaxed) != sequence) {
+            break;
+        }
+
+        if (entry.referenced.load(memory_order_relaxed) == 0) {
+            entry.referenced.store(1, memory_order_relaxed);
+        }
+
+        PLANNER_STAT_ADD(cacheHits, 1);
+
+        if ((lengths >> 32) == 0) {
+            PLANNER_STAT_ADD(cacheNegativeHits, 1);
+        }
+
+        out.write(reinterpret_cast<const char*>(response), static_cast<streamsize>(responseLength));
+
+        return true;
+    }
+
+    PLANNER_STAT_ADD(cacheMisses, 1);
+
+    return false;
+}
+
+/**
+ * Cache a response. If its set is full, the CLOCK algorithm evicts an
+ * entry that was not used since the hand last passed it. If another
+ * thread cached the key first, its entry is kept.
+ *
+ * @param key - The key of the response, such as an upper-case course number. Longer keys are not cached.
+ * @param response - The rendered response. Longer responses are not cached.
+ * @param found - Whether or not the response is for something that was found.
+ */
+void ResponseCache::Add(string_view key, const string& response, bool found) {
+    if (key.size() > maxKeyLength || response.size() > maxResponseLength) {
+        return;
+    }
+
+    uint64_t packedKey[keyWords];
+    uint64_t hash = std::hash<string_view>()(key);
+    size_t setIndex = hash & (setCount - 1);
+    Entry* set = &entries[setIndex * ways];
+
+    packKey(key, packedKey);
+
+    lock_guard<mutex> lock(addMutex);
+
+    uint32_t currentGeneration = generation.load(memory_order_relaxed);
+    uint64_t identity = (uint64_t(currentGeneration) << 32) | key.size();
+    size_t victim = ways;
+
+    for (size_t way = 0; way < ways; way++) {
+        if (holds(set[way], hash, identity, packedKey)) {
+            return;
+        }
+
+        // An entry from an earlier generation is empty.
+        if (victim == ways && (set[way].words[1].load(memory_order_relaxed) >> 32) != currentGeneration) {
+            victim = way;
+        }
+    }
+
+    // Every entry is in use, so sweep the hand past the recently used ones.
+    if (victim == ways) {
+        size_t hand = hands[setIndex];
+
+        while (set[hand].referenced.load(memory_order_relaxed) != 0) {
+            set[hand].referenced.store(0, memory_order_relaxed);
+            hand = (hand + 1) % ways;
+        }
+
+        victim = hand;
+        hands[setIndex] = static_cast<uint8_t>((hand + 1) % ways);
+
+        PLANNER_STAT_ADD(cacheEvictions, 1);
+    }
+
+    Entry& entry = set[victim];
+    uint32_t sequence = entry.sequence.load(memory_order_relaxed);
+
+    // Mark the entry as being written before any word changes.
+    entry.sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    entry.words[0].store(hash, memory_order_relaxed);
+    entry.words[1].store(identity, memory_order_relaxed);
+    entry.words[2].store((uint64_t(found) << 32) | response.size(), memory_order_relaxed);
+
+    for (size_t i = 0; i < keyWords; i++) {
+        entry.words[headerWords + i].store(packedKey[i], memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i * 8 < response.size(); i++) {
+        uint64_t word = 0;
+
+        memcpy(&word, response.data() + i * 8, min<size_t>(8, response.size() - i * 8));
+        entry.words[headerWords + keyWords + i].store(word, memory_order_relaxed);
+    }
+
+    entry.sequence.store(sequence + 2, memory_order_release);
+    entry.referenced.store(0, memory_order_relaxed);
+    filled.store(true, memory_order_relaxed);
+}
+
+/**
+ * Remove every entry, such as when the courses they were rendered from
+ * change. It must not be called while other threads use the cache.
+ */
+void ResponseCache::Clear() {
+    if (filled.load(memory_order_relaxed)) {
+        generation.fetch_add(1, memory_order_relaxed);
+        filled.store(false, memory_order_relaxed);
+    }
+}
+
+//============================================================================
+// Binary Search Tree class definition
+//============================================================================
+
+/**
+ * Define a class containing data members and methods to
+ * implement a binary search tree.
+ *
+ * The tree is kept height-balanced (AVL), so its depth stays O(log n)
+ * even when the courses arrive already sorted by course number. Every
+ * operation is iterative, so large catalogs cannot overflow the stack.
+ */
+class BinarySearchTree {
+
+private:
+    // An AVL tree of n nodes is at most about 1.44 * log2(n) levels deep.
+    static constexpr int maxHeight = 96;
+
+    Node* node;
+
+    // The storage for every node in the tree.
+    NodePool nodePool;
+
+    // The courses that the nodes refer to by ID.
+    CourseCatalog catalog;
+
+    // Scratch space for the prerequisite IDs of the course being inserted.
+    vector<uint32_t> prerequisiteIds;
+
+    // The read-only search index built by Freeze(). It is discarded whenever the tree changes.
+    FrozenIndex frozenIndex;
+    bool frozen;
+
+    // The words of every course name, and the prerequisite graph, by rank in the frozen index. They are built and discarded with it.
+    NameIndex nameIndex;
+    PrerequisiteGraph graph;
+
+    // Whether a course's name or prerequisites have changed since the name index and graph were built,
+    // while the frozen index stayed up to date.
+    bool coursesChanged;
+
+    // Whether courses were appended to the catalog without nodes. The tree has no nodes while this is set.
+    bool appendedCourses;
+
+    // The snapshot file that the catalog and index are read from, if the tree was opened from one.
+    MappedFile snapshotFile;
+
+    // The rendered details of recently printed courses, or null if they are not cached. It is emptied whenever the tree changes.
+    unique_ptr<ResponseCache> responseCache;
+
+    static int heightOf(Node* node);
+    static void updateHeight(Node* node);
+    static Node* rotateLeft(Node* node);
+    static Node* rotateRight(Node* node);
+    static Node* rebalance(Node* node);
+
+    int compareToNode(const CourseKey& key, string_view courseNumber, const Node* node) const;
+    void addNode(Node* newNode);
+    void buildBalanced(const vector<Node*>& sortedNodes);
+    uint32_t findCourse(string_view courseNumber) const;
+    void printCourse(uint32_t courseId, ostream& out) const;
+    void printPrerequisites(uint32_t courseId, ostream& out) const;
+    void printRanks(const char* label, const vector<uint32_t>& ranks, const FrozenIndex& rankIndex, ostream& out) const;
+    void printDependents(string_view courseNumber, ostream& out) const;
+    void thaw();
+    void compactCatalog();
+    template <typename Visit>
+    void visitFrom(string_view courseNumber, Visit visit) const;
+    template <typename Visit>
+    void visitGraph(Visit visit) const;
+    void printSampleSchedule(Node* node, ostream& out) const;
+    bool printCourseInformation(const string& courseNumber, ostream& out) const;
+#ifdef PLANNER_STATS
+    void recordDepths() const;
+#endif
+
+public:
+    BinarySearchTree();
+    virtual ~BinarySearchTree();
+    void Clear();
+    void Insert(const Course& course);
+    uint32_t Emplace(string_view courseNumber, string_view courseName, const string_view* prerequisites, size_t prerequisiteCount);
+    uint32_t Append(string_view courseNumber, string_view courseName, const string_view* prerequisites, size_t prerequisiteCount);
+    bool Update(string_view courseNumber, string_view courseName, const string_view* prerequisites, size_t prerequisiteCount);
+    bool Remove(string_view courseNumber);
+    bool Contains(string_view courseNumber) const;
+    void Diff(const ParsedCatalog& parsedCatalog, CatalogChanges& changes) const;
+    void ExportOtherDepartments(const vector<string_view>& departments, ParsedCatalog& before, ParsedCatalog& after) const;
+    void Reserve(size_t courseCount, size_t textSize, size_t prerequisiteCount);
+    void SetResponseCacheSize(size_t entryCount);
+    void Load(const ParsedCatalog& parsedCatalog, unsigned threadCount);
+    void Freeze();
+    bool CopyFrom(const BinarySearchTree& other);
+    size_t Size() const;
+    bool SaveSnapshot(const string& path, const CatalogStamp& source, uint32_t optionFlags) const;
+    bool OpenSnapshot(const string& path, const CatalogStamp& source, uint32_t optionFlags);
+    void PrintSampleSchedule(ostream& out = cout) const;
+    void PrintCourseInformation(string courseNumber, ostream& out = cout) const;
+    void PrintPrerequisites(string courseNumber, ostream& out = cout) const;
+    void PrintDependents(string courseNumber, ostream& out = cout) const;
+    void PrintCoursesInRange(string firstNumber, string lastNumber, ostream& out = cout) const;
+    void PrintCoursesWithPrefix(string prefix, ostream& out = cout) const;
+    void PrintCoursesNamed(string words, ostream& out = cout) const;
+    bool HasPrerequisiteCycle() const;
+    bool FindPrerequisiteCycle(const vector<uint32_t>& courseIds, vector<string>& courseNumbers) const;
+    bool HasMissingPrerequisites() const;
+    void PrintAllPrerequisites(string courseNumber, ostream& out = cout) const;
+    void PrintAllDependents(string courseNumber, ostream& out = cout) const;
+    void PrintStudyOrder(ostream& out = cout) const;
+    void PrintPlan(string courseNumbers, size_t termLimit, PlanBuffers& buffers, ostream& out = cout) const;
+};
+
+//============================================================================
+// BinarySearchTree private method definitions.
+//============================================================================
+
+/**
+ * Get the height of a sub-tree.
+ *
+ * @param node - The root of the sub-tree, or null for an empty sub-tree.
+ * @return The height of the sub-tree.
+ */
+int BinarySearchTree::heightOf(Node* node) {
+    return (node != nullptr) ? node->height : 0;
+}
+
+/**
+ * Recompute a node's height from the heights of its children.
+ *
+ * @param node - The node to update.
+ */
+void BinarySearchTree::updateHeight(Node* node) {
+    node->height = 1 + max(heightOf(node->left), heightOf(node->right));
+}
+
+/**
+ * Rotate a sub-tree to the left.
+ *
+ * @param node - The root of the sub-tree. It must have a right child.
+ * @return The new root of the sub-tree.
+ */
+Node* BinarySearchTree::rotateLeft(Node* node) {
+    Node* pivot = node->right;
+
+    node->right = pivot->left;
+    pivot->left = node;
+
+    // The old root is now below the pivot, so its height is updated first.
+    updateHeight(node);
+    updateHeight(pivot);
+
+    return pivot;
+}
+
+/**
+ * Rotate a sub-tree to the right.
+ *
+ * @param node - The root of the sub-tree. It must have a left child.
+ * @return The new root of the sub-tree.
+ */
+Node* BinarySearchTree::rotateRight(Node* node) {
+    Node* pivot = node->left;
+
+    node->left = pivot->right;
+    pivot->right = node;
+
+    // The old root is now below the pivot, so its height is updated first.
+    updateHeight(node);
+    updateHeight(pivot);
+
+    return pivot;
+}
+
+/**
+ * Update a node's height and rotate its sub-tree if it is out of balance.
+ *
+ * @param node - The root of the sub-tree to rebalance.
+ * @return The new root of the sub-tree.
+ */
+Node* BinarySearchTree::rebalance(Node* node) {
+    updateHeight(node);
+
+    int balance = heightOf(node->left) - heightOf(node->right);
+
+    // If the left sub-tree is too tall...
+    if (balance > 1) {
+        // Turn a left-right case into a left-left case.
+        if (heightOf(node->left->left) < heightOf(node->left->right)) {
+            node->left = rotateLeft(node->left);
+        }
+
+        return rotateRight(node);
+    }
+
+    // If the right sub-tree is too tall...
+    if (balance < -1) {
+        // Turn a right-left case into a right-right case.
+        if (heightOf(node->right->right) < heightOf(node->right->left)) {
+            node->right = rotateRight(node->right);
+        }
+
+        return rotateLeft(node);
+    }
+
+    return node;
+}
+
+/**
+ * Compare a course number to a node's course number. The node's course
+ * is only looked up in the catalog when both keys are too long to pack
+ * and share a prefix.
+ *
+ * @param key - The packed course number.
+ * @param courseNumber - The full course number.
+ * @param node - The node to compare with.
+ * @return A negative value, zero or a positive value like string::compare.
+ */
+int BinarySearchTree::compareToNode(const CourseKey& key, string_view courseNumber, const Node* node) const {
+    int comparison = key.Compare(node->key);
+
+    if (comparison != 0 || key.IsPacked()) {
+        return comparison;
+    }
+
+    return courseNumber.compare(catalog.Number(node->courseId));
+}
+
+/**
+ * Add a new node to the BST and rebalance the path above it.
+ *
+ * @param newNode - The node to be added.
+ */
+void BinarySearchTree::addNode(Node* newNode) {
+    // The link to each node on the path from the root down to the new node.
+    Node** path[maxHeight];
+    int depth = 0;
+
+    // Start at the link to the root.
+    Node** link = &node;
+
+    string_view newCourseNumber = catalog.Number(newNode->courseId);
+
+    // Walk down the tree until an empty link is reached.
+    while (*link != nullptr) {
+        path[depth++] = link;
+
+        // If the current node's course number is greater than the new course's course number...
+        if (compareToNode(newNode->key, newCourseNumber, *link) < 0) {
+            // Traverse down the left sub-tree.
+            link = &(*link)->left;
+        }
+        // If the current node's course number is less than or equal to the new course's course number...
+        else {
+            // Traverse down the right sub-tree.
+            link = &(*link)->right;
+        }
+    }
+
+    // Attach the new node at the empty link.
+    *link = newNode;
+
+    // Rebalance each ancestor from the bottom up.
+    while (depth > 0) {
+        link = path[--depth];
+
+        int oldHeight = (*link)->height;
+
+        *link = rebalance(*link);
+
+        // Once a sub-tree's height is unchanged, nothing above it can be out of balance.
+        if ((*link)->height == oldHeight) {
+            break;
+        }
+    }
+}
+
+/**
+ * Link nodes that are already in ascending order into a perfectly balanced
+ * tree, replacing the tree's current links. The middle node of each range
+ * becomes the root of that range, so no rotations are needed.
+ *
+ * @param sortedNodes - Every node of the tree, in ascending order.
+ */
+void BinarySearchTree::buildBalanced(const vector<Node*>& sortedNodes) {
+    // Define a structure to hold a range of nodes that still has to be linked below a parent.
+    struct PendingRange {
+        size_t first;
+        size_t last;
+        Node** link;
+    };
+
+    vector<PendingRange> pendingRanges;
+    pendingRanges.push_back({ 0, sortedNodes.size(), &node });
+
+    while (!pendingRanges.empty()) {
+        PendingRange range = pendingRanges.back();
+        pendingRanges.pop_back();
+
+        size_t size = range.last - range.first;
+
+        // An empty range is an empty sub-tree.
+        if (size == 0) {
+            *range.link = nullptr;
+            continue;
+        }
+
+        size_t middle = range.first + size / 2;
+        Node* root = sortedNodes[middle];
+
+        // The halves differ in size by at most one, so the height is the bit width of the size.
+        int height = 0;
+
+        while (size > 0) {
+            height++;
+            size >>= 1;
+        }
+
+        root->height = height;
+        *range.link = root;
+
+        pendingRanges.push_back({ range.first, middle, &root->left });
+        pendingRanges.push_back({ middle + 1, range.last, &root->right });
+    }
+}
+
+/**
+ * Discard the frozen index and the cached responses before the tree changes.
+ */
+void BinarySearchTree::thaw() {
+    // Any change to the tree can change what a course's details print.
+    if (responseCache != nullptr) {
+        responseCache->Clear();
+    }
+
+    // Appended courses have no nodes, so index them first and build their nodes from the index below.
+    if (appendedCourses) {
+        frozenIndex.Build(catalog);
+        appendedCourses = false;
+        frozen = true;
+    }
+
+    if (frozen) {
+        // A tree opened from a snapshot has no nodes yet, so build them from the index first.
+        if (node == nullptr && frozenIndex.Size() > 0) {
+            vector<Node*> sortedNodes;
+            sortedNodes.reserve(frozenIndex.Size());
+
+            for (size_t rank = 0; rank < frozenIndex.Size(); rank++) {
+                uint32_t courseId = frozenIndex.At(rank);
+
+                sortedNodes.push_back(nodePool.Allocate(CourseKey(catalog.Number(courseId)), courseId));
+            }
+
+            buildBalanced(sortedNodes);
+        }
+
+        frozenIndex.Clear();
+        nameIndex.Clear();
+        graph.Clear();
+        coursesChanged = false;
+        frozen = false;
+    }
+}
+
+/**
+ * Compact the catalog and give each node its course's new ID. The index
+ * refers to the old IDs, so it is discarded first.
+ */
+void BinarySearchTree::compactCatalog() {
+    thaw();
+
+    vector<uint32_t> newIds;
+
+    catalog.Compact(newIds);
+
+    // Renumber every node with an iterative pre-order traversal.
+    vector<Node*> pendingNodes;
+
+    if (node != nullptr) {
+        pendingNodes.push_back(node);
+    }
+
+    while (!pendingNodes.empty()) {
+        Node* currentNode = pendingNodes.back();
+        pendingNodes.pop_back();
+
+        currentNode->courseId = newIds[currentNode->courseId];
+
+        if (currentNode->left != nullptr) {
+            pendingNodes.push_back(currentNode->left);
+        }
+
+        if (currentNode->right != nullptr) {
+            pendingNodes.push_back(currentNode->right);
+        }
+    }
+}
+
+/**
+ * Visit the courses in ascending order of course number, starting at the
+ * first course that is not smaller than a course number. Only the path down
+ * to that course and the visited courses are read, so visiting k courses
+ * costs O(log n + k).
+ *
+ * @param courseNumber - The upper-case course number to start at.
+ * @param visit - Called with the ID of each course. Returns whether to keep visiting.
+ */
+template <typename Visit>
+void BinarySearchTree::visitFrom(string_view courseNumber, Visit visit) const {
+    // If the tree is frozen, the courses from the lower bound on are contiguous in the index.
+    if (frozen) {
+        for (size_t rank = frozenIndex.LowerBound(courseNumber); rank < frozenIndex.Size(); rank++) {
+            if (!visit(frozenIndex.At(rank))) {
+                return;
+            }
+        }
+
+        return;
+    }
+
+    CourseKey key(courseNumber);
+
+    // The nodes still to be visited, with the next one on top. Their right sub-trees are visited after them.
+    Node* pendingNodes[maxHeight];
+    int pendingCount = 0;
+
+    Node* currentNode = node;
+
+    // Walk down to the lower bound, keeping every node on the way that is not smaller than the course number.
+    while (currentNode != nullptr) {
+        // If the course number is not larger than the current node's...
+        if (compareToNode(key, courseNumber, currentNode) <= 0) {
+            pendingNodes[pendingCount++] = currentNode;
+            currentNode = currentNode->left;
+        }
+        else {
+            currentNode = currentNode->right;
+        }
+    }
+
+    // Continue the in-order traversal from the lower bound.
+    while (pendingCount > 0) {
+        currentNode = pendingNodes[--pendingCount];
+
+        if (!visit(currentNode->courseId)) {
+            return;
+        }
+
+        // Visit the right sub-tree next, starting at its smallest course number.
+        for (currentNode = currentNode->right; currentNode != nullptr; currentNode = currentNode->left) {
+            pendingNodes[pendingCount++] = currentNode;
+        }
+    }
+}
+
+/**
+ * Call a function with the prerequisite graph and the index whose ranks are
+ * its nodes. If the tree's graph is not up to date, one is built for this
+ * call only.
+ *
+ * @param visit - Called with the index and the graph.
+ */
+template <typename Visit>
+void BinarySearchTree::visitGraph(Visit visit) const {
+    if (frozen && !coursesChanged) {
+        visit(frozenIndex, graph);
+
+        return;
+    }
+
+    FrozenIndex currentIndex;
+    PrerequisiteGraph currentGraph;
+
+    if (!frozen) {
+        currentIndex.Build(node, catalog);
+    }
+
+    const FrozenIndex& graphIndex = frozen ? frozenIndex : currentIndex;
+
+    currentGraph.Build(catalog, graphIndex);
+    visit(graphIndex, currentGraph);
+}
+
+/**
+* Traverse the BST in order and print each node.
+* 
+* @param node - The root of the sub-tree to print.
+* @param out - The stream to print to.
+*/
+void BinarySearchTree::printSampleSchedule(Node* node, ostream& out) const {
+    // If the tree is frozen, print from the index's contiguous array instead of walking the nodes.
+    if (frozen) {
+        for (size_t rank = 0; rank < frozenIndex.Size(); rank++) {
+            uint32_t courseId = frozenIndex.At(rank);
+
+            // Print the course number and course name.
+            out << catalog.Number(courseId) << ", "
+                << catalog.Name(courseId) << '\n';
+        }
+
+        return;
+    }
+
+    // The nodes whose left sub-trees are being printed.
+    Node* pendingNodes[maxHeight];
+    int pendingCount = 0;
+
+    Node* currentNode = node;
+
+    // Keep going until every node has been printed.
+    while (currentNode != nullptr || pendingCount > 0) {
+        // Walk down to the smallest course number in the current sub-tree.
+        while (currentNode != nullptr) {
+            pendingNodes[pendingCount++] = currentNode;
+            currentNode = currentNode->left;
+        }
+
+        currentNode = pendingNodes[--pendingCount];
+
+        // Print the node's course number and course name.
+        out << catalog.Number(currentNode->courseId) << ", "
+            << catalog.Name(currentNode->courseId) << '\n';
+
+        // Print the right sub-tree next.
+        currentNode = currentNode->right;
+    }
+}
+
+/**
+ * Print a course's number, name and prerequisites.
+ * Each prerequisite's course number is looked up by its ID.
+ *
+ * @param courseId - The ID of the course to print.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::printCourse(uint32_t courseId, ostream& out) const {
+    // Print the course number and course name.
+    out << catalog.Number(courseId) << ", "
+        << catalog.Name(courseId) << '\n';
+
+    printPrerequisites(courseId, out);
+}
+
+/**
+ * Print a course's prerequisites on one line.
+ *
+ * @param courseId - The ID of the course whose prerequisites to print.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::printPrerequisites(uint32_t courseId, ostream& out) const {
+    CourseCatalog::IdRange prerequisites = catalog.Prerequisites(courseId);
+
+    // Prerequisite identifier string.
+    out << "Prerequisites: ";
+
+    // If the course has any prerequisites...
+    if (!prerequisites.empty()) {
+        // Print each prerequisite course number.
+        for (const uint32_t* prerequisite = prerequisites.begin(); prerequisite != prerequisites.end(); prerequisite++) {
+            // If the current prerequisite is not the first one, separate it from the previous one with a comma.
+            if (prerequisite != prerequisites.begin()) {
+                out << ", ";
+            }
+
+            out << catalog.Number(*prerequisite);
+        }
+
+        out << '\n';
+    }
+    else {
+        // Print a message to show that the course has no prerequities.
+        out << "None" << '\n';
+    }
+}
+
+/**
+ * Print the course numbers of some ranks in an index on one line.
+ *
+ * @param label - The text before the course numbers.
+ * @param ranks - The ranks of the courses to print, in order.
+ * @param rankIndex - The index that the ranks are in.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::printRanks(const char* label, const vector<uint32_t>& ranks, const FrozenIndex& rankIndex, ostream& out) const {
+    out << label << ": ";
+
+    // If there are no courses...
+    if (ranks.empty()) {
+        out << "None" << '\n';
+
+        return;
+    }
+
+    // Print each course number, separated by commas.
+    for (size_t i = 0; i < ranks.size(); i++) {
+        if (i > 0) {
+            out << ", ";
+        }
+
+        out << catalog.Number(rankIndex.At(ranks[i]));
+    }
+
+    out << '\n';
+}
+
+/**
+ * Print the courses that have a course as a direct prerequisite on one line.
+ *
+ * @param courseNumber - The upper-case number of a course in the tree.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::printDependents(string_view courseNumber, ostream& out) const {
+    visitGraph([&](const FrozenIndex& graphIndex, const PrerequisiteGraph& prerequisiteGraph) {
+        // The course is the first one in the index with its course number.
+        CourseCatalog::IdRange dependents = prerequisiteGraph.Dependents(static_cast<uint32_t>(graphIndex.LowerBound(courseNumber)));
+
+        printRanks("Required for", vector<uint32_t>(dependents.begin(), dependents.end()), graphIndex, out);
+    });
+}
+
+/**
+ * Find a course by its course number.
+ *
+ * @param courseNumber - The upper-case course number to find.
+ * @return The ID of the course, or noCourse if it is not in the tree.
+ */
+uint32_t BinarySearchTree::findCourse(string_view courseNumber) const {
+    PLANNER_STAT_LOOKUP();
+
+    // The ID of the course with the specified course number, if it is found.
+    uint32_t foundCourse = CourseCatalog::noCourse;
+
+    // If the tree is frozen, search the index instead of walking the nodes.
+    if (frozen) {
+        foundCourse = frozenIndex.Find(courseNumber);
+    }
+    else {
+        // Pack the course number once so that each node is compared on its key.
+        CourseKey key(courseNumber);
+
+        // Set the current node to the root.
+        Node* currentNode = node;
+
+        // Keep looping downwards until the bottom of the tree is reached or a matching course number is found.
+        while (currentNode != nullptr) {
+            int comparison = compareToNode(key, courseNumber, currentNode);
+
+            PLANNER_STAT_COMPARISON();
+
+            // If the current node's course contains the specified courseNumber...
+            if (comparison == 0) {
+                foundCourse = currentNode->courseId;
+
+                // Stop searching after the course is found.
+                break;
+            }
+            // If the specified course number is smaller than the course number at the current node...
+            else if (comparison < 0) {
+                // Traverse the left sub-tree.
+                currentNode = currentNode->left;
+            }
+            // If the specified course number is larger than the course number at the current node...
+            else {
+                // Traverse the right sub-tree.
+                currentNode = currentNode->right;
+            }
+        }
+    }
+
+    return foundCourse;
+}
+
+/**
+ * Find and print a course.
+ *
+ * @param courseNumber - The upper-case course number to find.
+ * @param out - The stream to print to.
+ * @return Whether or not the course was found.
+ */
+bool BinarySearchTree::printCourseInformation(const string& courseNumber, ostream& out) const {
+    uint32_t foundCourse = findCourse(courseNumber);
+
+    // If the specified course was found...
+    if (foundCourse != CourseCatalog::noCourse) {
+        printCourse(foundCourse, out);
+        printDependents(courseNumber, out);
+
+        return true;
+    }
+
+    // Print a message to show that the course was not found.
+    out << "Course not found." << '\n';
+
+    return false;
+}
+
+//============================================================================
+// BinarySearchTree public method definitions.
+//============================================================================
+
+/**
+ * Default constructor
+ */
+BinarySearchTree::BinarySearchTree() {
+    // The root node is initially null.
+    node = nullptr;
+
+    // An empty tree has nothing to freeze.
+    frozen = false;
+    coursesChanged = false;
+    appendedCourses = false;
+}
+
+/**
+ * Destructor
+ */
+BinarySearchTree::~BinarySearchTree() {
+    // The node pool releases every node when it is destroyed.
+}
+
+/**
+ * Remove all elements from the BST.
+ */
+void BinarySearchTree::Clear() {
+    // The frozen index refers to the nodes that are about to be released.
+    thaw();
+
+    // Release every node in the BST at once, and every course they refer to.
+    nodePool.Clear();
+    catalog.Clear();
+    snapshotFile.Close();
+
+    // Reinitialize the root node after deleting all nodes from the BST.
+    node = nullptr;
+}
+
+/**
+ * Insert a course into the BST.
+ *
+ * @param course - The course to insert. Its fields are copied into the tree's catalog.
+ */
+void BinarySearchTree::Insert(const Course& course) {
+    vector<string_view> prerequisites(course.prerequisites.begin(), course.prerequisites.end());
+
+    Emplace(course.courseNumber, course.courseName, prerequisites.data(), prerequisites.size());
+}
+
+/**
+ * Add a course to the tree's catalog and insert it into the BST.
+ * Each prerequisite is stored as the ID of its course number, which
+ * does not need to have been inserted yet.
+ *
+ * @param courseNumber - The upper-case course number.
+ * @param courseName - The course name.
+ * @param prerequisites - The upper-case course numbers of the course's prerequisites.
+ * @param prerequisiteCount - The number of prerequisites.
+ * @return The ID of the course in the tree's catalog.
+ */
+uint32_t BinarySearchTree::Emplace(string_view courseNumber, string_view courseName,
+        const string_view* prerequisites, size_t prerequisiteCount) {
+    PLANNER_STAT_PHASE(insertPhase);
+
+    // The frozen index would not contain the new course.
+    thaw();
+
+    // Intern each prerequisite's course number.
+    prerequisiteIds.clear();
+
+    for (size_t i = 0; i < prerequisiteCount; i++) {
+        prerequisiteIds.push_back(catalog.Intern(prerequisites[i]));
+    }
+
+    uint32_t courseId = catalog.Define(courseNumber, courseName, prerequisiteIds.data(), prerequisiteIds.size());
+
+    // Add a node with the given course into the correct place in the BST.
+    addNode(nodePool.Allocate(CourseKey(courseNumber), courseId));
+
+    return courseId;
+}
+
+/**
+ * Add a course to the catalog without giving it a node, to load a large
+ * catalog in less memory. Freeze() then builds the index straight from the
+ * catalog. Until it does, Contains() is the only lookup that sees appended
+ * courses. If the tree already has nodes or an index, the course is
+ * emplaced instead.
+ *
+ * @param courseNumber - The upper-case course number.
+ * @param courseName - The course name.
+ * @param prerequisites - The upper-case course numbers of the prerequisites.
+ * @param prerequisiteCount - The number of prerequisites.
+ * @return The ID of the course in the tree's catalog.
+ */
+uint32_t BinarySearchTree::Append(string_view courseNumber, string_view courseName,
+        const string_view* prerequisites, size_t prerequisiteCount) {
+    if (node != nullptr || frozen) {
+        return Emplace(courseNumber, courseName, prerequisites, prerequisiteCount);
+    }
+
+    PLANNER_STAT_PHASE(insertPhase);
+
+    // Intern each prerequisite's course number.
+    prerequisiteIds.clear();
+
+    for (size_t i = 0; i < prerequisiteCount; i++) {
+        prerequisiteIds.push_back(catalog.Intern(prerequisites[i]));
+    }
+
+    appendedCourses = true;
+
+    return catalog.Define(courseNumber, courseName, prerequisiteIds.data(), prerequisiteIds.size());
+}
+
+/**
+ * Replace the name and prerequisites of a course that is in the tree.
+ * The tree and its frozen index are ordered by course number alone, so
+ * neither changes.
+ *
+ * @param courseNumber - The upper-case course number of the course to update.
+ * @param courseName - The new course name.
+ * @param prerequisites - The upper-case course numbers of the new prerequisites.
+ * @param prerequisiteCount - The number of prerequisites.
+ * @return Whether or not the course was found.
+ */
+bool BinarySearchTree::Update(string_view courseNumber, string_view courseName,
+        const string_view* prerequisites, size_t prerequisiteCount) {
+    uint32_t courseId = catalog.Find(courseNumber);
+
+    if (courseId == CourseCatalog::noCourse || !catalog.IsDefined(courseId)) {
+        return false;
+    }
+
+    // Intern each prerequisite's course number.
+    prerequisiteIds.clear();
+
+    for (size_t i = 0; i < prerequisiteCount; i++) {
+        prerequisiteIds.push_back(catalog.Intern(prerequisites[i]));
+    }
+
+    CourseCatalog::IdRange oldPrerequisites = catalog.Prerequisites(courseId);
+
+    // A changed course keeps its place in the frozen index, but its words and prerequisites must be indexed again.
+    if (catalog.Name(courseId) != courseName
+            || !equal(oldPrerequisites.begin(), oldPrerequisites.end(), prerequisiteIds.begin(), prerequisiteIds.end())) {
+        coursesChanged = true;
+    }
+
+    catalog.Update(courseId, courseName, prerequisiteIds.data(), prerequisiteIds.size());
+
+    // The course's printed details, and those of its old and new prerequisites, may have changed.
+    if (responseCache != nullptr) {
+        responseCache->Clear();
+    }
+
+    return true;
+}
+
+/**
+ * Remove a course from the tree and rebalance the path above it. If several
+ * courses share the course number, the one that lookups find is removed.
+ *
+ * @param courseNumber - The upper-case course number of the course to remove.
+ * @return Whether or not the course was found.
+ */
+bool BinarySearchTree::Remove(string_view courseNumber) {
+    PLANNER_STAT_PHASE(insertPhase);
+
+    uint32_t courseId = catalog.Find(courseNumber);
+
+    if (courseId == CourseCatalog::noCourse || !catalog.IsDefined(courseId)) {
+        return false;
+    }
+
+    // The frozen index would still contain the course.
+    thaw();
+
+    // The link to each node on the path from the root down to the removed node's replacement.
+    Node** path[maxHeight];
+    int depth = 0;
+
+    // Start at the link to the root.
+    Node** link = &node;
+
+    CourseKey key(courseNumber);
+
+    // Walk down to the course's node. Courses with the same number are ordered by ID, and lookups find the first.
+    while (*link != nullptr && (*link)->courseId != courseId) {
+        path[depth++] = link;
+
+        // If the course number is less than or equal to the current node's course number...
+        if (compareToNode(key, courseNumber, *link) <= 0) {
+            // Traverse down the left sub-tree.
+            link = &(*link)->left;
+        }
+        // If the course number is greater than the current node's course number...
+        else {
+            // Traverse down the right sub-tree.
+            link = &(*link)->right;
+        }
+    }
+
+    // If the course is not in the tree...
+    if (*link == nullptr) {
+        return false;
+    }
+
+    Node* removedNode = *link;
+
+    // If the node has at most one child, the child takes its place.
+    if (removedNode->left == nullptr || removedNode->right == nullptr) {
+        *link = (removedNode->left != nullptr) ? removedNode->left : removedNode->right;
+    }
+    // Otherwise, the smallest node of its right sub-tree takes its place.
+    else {
+        int removedDepth = depth;
+        Node** successorLink = &removedNode->right;
+
+        path[depth++] = link;
+
+        while ((*successorLink)->left != nullptr) {
+            path[depth++] = successorLink;
+            successorLink = &(*successorLink)->left;
+        }
+
+        Node* successor = *successorLink;
+
+        // Unlink the successor, then move it into the removed node's position.
+        *successorLink = successor->right;
+
+        successor->left = removedNode->left;
+        successor->right = removedNode->right;
+        successor->height = removedNode->height;
+
+        *link = successor;
+
+        // The path went through the removed node's right link, which now belongs to the successor.
+        if (removedDepth + 1 < depth) {
+            path[removedDepth + 1] = &successor->right;
+        }
+    }
+
+    // Rebalance each ancestor from the bottom up.
+    while (depth > 0) {
+        link = path[--depth];
+
+        int oldHeight = (*link)->height;
+
+        *link = rebalance(*link);
+
+        // Once a sub-tree's height is unchanged, nothing above it can be out of balance.
+        if ((*link)->height == oldHeight) {
+            break;
+        }
+    }
+
+    nodePool.Release(removedNode);
+    catalog.Remove(courseId);
+
+    return true;
+}
+
+/**
+ * Determine whether a course number is in the tree.
+ *
+ * @param courseNumber - The upper-case course number.
+ */
+bool BinarySearchTree::Contains(string_view courseNumber) const {
+    uint32_t courseId = catalog.Find(courseNumber);
+
+    return courseId != CourseCatalog::noCourse && catalog.IsDefined(courseId);
+}
+
+/**
+ * Compare the courses in the tree with the courses parsed from a csv file
+ * by course number. Courses that are in both with the same name and
+ * prerequisites are unchanged, and are not touched by the comparison.
+ *
+ * @param parsedCatalog - The courses parsed from the csv file.
+ * @param changes - The differences, to be applied with Emplace, Update and Remove.
+ */
+void BinarySearchTree::Diff(const ParsedCatalog& parsedCatalog, CatalogChanges& changes) const {
+    changes = CatalogChanges();
+
+    // Whether each loaded course has a line in the csv file, and whether that line changed it.
+    vector<char> matched(catalog.Size(), 0);
+    vector<char> changed(catalog.Size(), 0);
+
+    for (size_t i = 0; i < parsedCatalog.courses.size(); i++) {
+        const ParsedCourse& course = parsedCatalog.courses[i];
+        uint32_t courseId = catalog.Find(course.courseNumber);
+        uint32_t courseIndex = static_cast<uint32_t>(i);
+
+        // If the course number is not loaded, the course is new.
+        if (courseId == CourseCatalog::noCourse || !catalog.IsDefined(courseId)) {
+            if (!changes.insertedNumbers.emplace(course.courseNumber, courseIndex).second) {
+                changes.duplicateCourses = true;
+            }
+
+            changes.insertedCourses.push_back(courseIndex);
+            continue;
+        }
+
+        // A second line with a loaded course number is a duplicate.
+        if (matched[courseId]) {
+            changes.duplicateCourses = true;
+            continue;
+        }
+
+        matched[courseId] = 1;
+
+        // Compare the name and then each prerequisite's course number.
+        CourseCatalog::IdRange prerequisites = catalog.Prerequisites(courseId);
+        bool isSame = catalog.Name(courseId) == course.courseName && prerequisites.size() == course.prerequisiteCount;
+
+        for (uint32_t j = 0; isSame && j < course.prerequisiteCount; j++) {
+            isSame = catalog.Number(prerequisites.first[j]) == parsedCatalog.prerequisites[course.prerequisiteOffset + j];
+        }
+
+        if (!isSame) {
+            changed[courseId] = 1;
+            changes.updatedCourses.push_back(courseIndex);
+        }
+    }
+
+    // Every loaded course without a line in the csv file is removed.
+    vector<char> removed(catalog.Size(), 0);
+
+    for (uint32_t courseId = 0; courseId < catalog.Size(); courseId++) {
+        if (!catalog.IsDefined(courseId) || matched[courseId]) {
+            continue;
+        }
+
+        // A loaded course that lookups never find is a duplicate.
+        if (catalog.Find(catalog.Number(courseId)) != courseId) {
+            changes.duplicateCourses = true;
+        }
+
+        removed[courseId] = 1;
+        changes.removedCourses.emplace_back(catalog.Number(courseId));
+    }
+
+    // Unchanged courses are only affected by a removal if it was one of their prerequisites.
+    if (!changes.removedCourses.empty()) {
+        for (uint32_t courseId = 0; courseId < catalog.Size() && !changes.removedPrerequisite; courseId++) {
+            if (!matched[courseId] || changed[courseId]) {
+                continue;
+            }
+
+            for (uint32_t prerequisite : catalog.Prerequisites(courseId)) {
+                if (removed[prerequisite]) {
+                    changes.removedPrerequisite = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Export every course outside some departments as parsed courses, so that
+ * they can be joined with the lines of the departments' csv files and
+ * reloaded. The courses keep the order they were loaded in. Those loaded
+ * before the first course of the departments are exported to one catalog
+ * and the rest to another, so that the departments' lines take their place.
+ *
+ * The exported fields refer to this tree, which must not change while they are used.
+ *
+ * @param departments - The departments to leave out, sorted.
+ * @param before - Receives the courses loaded before the departments.
+ * @param after - Receives the courses loaded after the first course of the departments.
+ */
+void BinarySearchTree::ExportOtherDepartments(const vector<string_view>& departments, ParsedCatalog& before, ParsedCatalog& after) const {
+    before = ParsedCatalog();
+    after = ParsedCatalog();
+
+    ParsedCatalog* exported = &before;
+
+    for (uint32_t courseId = 0; courseId < catalog.Size(); courseId++) {
+        if (!catalog.IsDefined(courseId)) {
+            continue;
+        }
+
+        string_view courseNumber = catalog.Number(courseId);
+
+        // The courses of the departments are left out, and the courses after the first one go after them.
+        if (binary_search(departments.begin(), departments.end(), departmentOf(courseNumber))) {
+            exported = &after;
+            continue;
+        }
+
+        CourseCatalog::IdRange prerequisites = catalog.Prerequisites(courseId);
+        ParsedCourse course;
+
+        course.courseNumber = courseNumber;
+        course.courseName = catalog.Name(courseId);
+        course.prerequisiteOffset = static_cast<uint32_t>(exported->prerequisites.size());
+        course.prerequisiteCount = static_cast<uint32_t>(prerequisites.size());
+
+        for (uint32_t prerequisite : prerequisites) {
+            exported->prerequisites.push_back(catalog.Number(prerequisite));
+        }
+
+        exported->courses.push_back(course);
+    }
+}
+
+/**
+ * Reserve space for a known number of courses before inserting them.
+ *
+ * @param courseCount - The number of courses.
+ * @param textSize - The total length of every course number and name.
+ * @param prerequisiteCount - The total number of prerequisites.
+ */
+void BinarySearchTree::Reserve(size_t courseCount, size_t textSize, size_t prerequisiteCount) {
+    catalog.Reserve(courseCount, textSize, prerequisiteCount);
+}
+
+/**
+ * Set the most rendered course details that are cached for repeated lookups,
+ * replacing the cache with an empty one. Like every change to the tree, it
+ * must be made before the tree is published.
+ *
+ * @param entryCount - The most cached courses, rounded up to a power of two. Zero disables the cache.
+ */
+void BinarySearchTree::SetResponseCacheSize(size_t entryCount) {
+    responseCache.reset((entryCount > 0) ? new ResponseCache(entryCount) : nullptr);
+}
+
+/**
+ * Insert every course from a parsed and checked csv file.
+ *
+ * When the tree is empty, each course's ID is its index in the file, so the
+ * prerequisites that checkFileFormat resolved are stored without looking up
+ * their course numbers again. The tree is then bulk-built: the courses are
+ * sorted by key (in parallel when there are several threads) and linked
+ * into a balanced tree, with the nodes allocated in ascending order.
+ *
+ * @param parsedCatalog - The courses parsed from the csv file and checked by checkFileFormat.
+ * @param threadCount - The number of threads to sort the courses with.
+ */
+void BinarySearchTree::Load(const ParsedCatalog& parsedCatalog, unsigned threadCount) {
+    PLANNER_STAT_PHASE(insertPhase);
+
+    // The resolved prerequisites are only valid as IDs in an empty catalog.
+    if (catalog.Size() > 0) {
+        for (const ParsedCourse& course : parsedCatalog.courses) {
+            Emplace(course.courseNumber, course.courseName,
+                parsedCatalog.prerequisites.data() + course.prerequisiteOffset, course.prerequisiteCount);
+        }
+
+        return;
+    }
+
+    // The frozen index would not contain the new courses.
+    thaw();
+
+    size_t textSize = 0;
+
+    for (const ParsedCourse& course : parsedCatalog.courses) {
+        textSize += course.courseNumber.size() + course.courseName.size();
+    }
+
+    // Size the catalog once for every course. Each course is stored as its number, name and prerequisite IDs.
+    catalog.Reserve(parsedCatalog.courses.size(), textSize, parsedCatalog.prerequisites.size());
+
+    // Define a structure to hold a course while the courses are sorted.
+    struct SortEntry {
+        CourseKey key;
+        uint32_t courseId;
+    };
+
+    vector<SortEntry> sortEntries;
+    sortEntries.reserve(parsedCatalog.courses.size());
+
+    for (const ParsedCourse& course : parsedCatalog.courses) {
+        // Courses are defined in file order, so each one's ID is its index in the file.
+        uint32_t courseId = catalog.Define(course.courseNumber, course.courseName,
+            parsedCatalog.prerequisiteCourses.data() + course.prerequisiteOffset, course.prerequisiteCount);
+
+        sortEntries.push_back({ CourseKey(course.courseNumber), courseId });
+    }
+
+    // Sort by course number. Equal course numbers stay in file order, as if they had been inserted one by one.
+    parallelSort(sortEntries, [this](const SortEntry& entry, const SortEntry& other) {
+        int comparison = entry.key.Compare(other.key);
+
+        if (comparison == 0 && !entry.key.IsPacked()) {
+            comparison = catalog.Number(entry.courseId).compare(catalog.Number(other.courseId));
+        }
+
+        return (comparison != 0) ? (comparison < 0) : (entry.courseId < other.courseId);
+    }, threadCount);
+
+    // Allocate the nodes in ascending order so that in-order walks read memory front to back.
+    vector<Node*> sortedNodes;
+    sortedNodes.reserve(sortEntries.size());
+
+    for (const SortEntry& entry : sortEntries) {
+        sortedNodes.push_back(nodePool.Allocate(entry.key, entry.courseId));
+    }
+
+    buildBalanced(sortedNodes);
+}
+
+/**
+ * Build the read-only search index from the current tree.
+ * Lookups and listings are served from the index until the tree changes.
+ */
+void BinarySearchTree::Freeze() {
+    PLANNER_STAT_PHASE(indexPhase);
+
+    // Drop what updates and removals have left unused in the catalog. The courses are renumbered, so the whole index is rebuilt.
+    if (catalog.ShouldCompact()) {
+        compactCatalog();
+    }
+
+    // The index is still up to date if the tree has not changed since it was built.
+    if (frozen) {
+        // Changed courses keep their place in the index, so only the name index and graph are rebuilt.
+        if (coursesChanged) {
+            nameIndex.Build(catalog, frozenIndex);
+            graph.Build(catalog, frozenIndex);
+            coursesChanged = false;
+        }
+
+        return;
+    }
+
+    // Appended courses have no nodes, so they are indexed from the catalog.
+    if (appendedCourses) {
+        frozenIndex.Build(catalog);
+        appendedCourses = false;
+    }
+    else {
+        frozenIndex.Build(node, catalog);
+    }
+
+    nameIndex.Build(catalog, frozenIndex);
+    graph.Build(catalog, frozenIndex);
+    coursesChanged = false;
+    frozen = true;
+
+#ifdef PLANNER_STATS
+    recordDepths();
+#endif
+}
+
+#ifdef PLANNER_STATS
+/**
+ * Record the depth of the tree's nodes and of the frozen index in the
+ * statistics. A tree opened from a snapshot has no nodes, only the index.
+ */
+void BinarySearchTree::recordDepths() const {
+    uint64_t nodeCount = 0;
+    uint64_t maxDepth = 0;
+    uint64_t depthTotal = 0;
+
+    // Walk every node with its depth.
+    vector<pair<const Node*, uint64_t>> pendingNodes;
+
+    if (node != nullptr) {
+        pendingNodes.emplace_back(node, 1);
+    }
+
+    while (!pendingNodes.empty()) {
+        const Node* currentNode = pendingNodes.back().first;
+        uint64_t depth = pendingNodes.back().second;
+
+        pendingNodes.pop_back();
+        nodeCount++;
+        maxDepth = max(maxDepth, depth);
+        depthTotal += depth;
+
+        for (const Node* child : { currentNode->left, currentNode->right }) {
+            if (child != nullptr) {
+                pendingNodes.emplace_back(child, depth + 1);
+            }
+        }
+    }
+
+    plannerStats.treeNodes.store(nodeCount, memory_order_relaxed);
+    plannerStats.treeMaxDepth.store(maxDepth, memory_order_relaxed);
+    plannerStats.treeDepthTotal.store(depthTotal, memory_order_relaxed);
+
+    // Eytzinger position p of the frozen index is searched at depth floor(log2(p)) + 1, so add up each full level.
+    uint64_t indexSize = frozenIndex.Size();
+
+    maxDepth = 0;
+    depthTotal = 0;
+
+    for (uint64_t levelStart = 1; levelStart <= indexSize; levelStart *= 2) {
+        maxDepth++;
+        depthTotal += maxDepth * (min(2 * levelStart - 1, indexSize) - levelStart + 1);
+    }
+
+    plannerStats.indexSize.store(indexSize, memory_order_relaxed);
+    plannerStats.indexMaxDepth.store(maxDepth, memory_order_relaxed);
+    plannerStats.indexDepthTotal.store(depthTotal, memory_order_relaxed);
+}
+#endif
+
+/**
+ * Replace the tree with a copy of another frozen tree. Only the catalog's
+ * and index's arrays are copied. The nodes are rebuilt from the index if
+ * the copy is changed.
+ *
+ * @param other - The tree to copy. It must be frozen, and is only read.
+ * @return Whether or not the tree was copied.
+ */
+bool BinarySearchTree::CopyFrom(const BinarySearchTree& other) {
+    Clear();
+
+    if (!other.frozen) {
+        return false;
+    }
+
+    catalog.Assign(other.catalog.GetArrays());
+    frozenIndex.Assign(other.frozenIndex.GetArrays(), catalog);
+    nameIndex.Assign(other.nameIndex.GetArrays());
+    graph.Assign(other.graph.GetArrays());
+    coursesChanged = other.coursesChanged;
+    frozen = true;
+
+    return true;
+}
+
+/**
+ * Get the number of courses in the tree.
+ */
+size_t BinarySearchTree::Size() const {
+    if (frozen) {
+        return frozenIndex.Size();
+    }
+
+    // Appended courses are only in the catalog.
+    if (appendedCourses) {
+        size_t count = 0;
+
+        for (uint32_t courseId = 0; courseId < catalog.Size(); courseId++) {
+            count += catalog.IsDefined(courseId) ? 1 : 0;
+        }
+
+        return count;
+    }
+
+    // Count the nodes with an iterative pre-order traversal.
+    vector<const Node*> pendingNodes;
+    size_t count = 0;
+
+    if (node != nullptr) {
+        pendingNodes.push_back(node);
+    }
+
+    while (!pendingNodes.empty()) {
+        const Node* currentNode = pendingNodes.back();
+        pendingNodes.pop_back();
+
+        count++;
+
+        if (currentNode->left != nullptr) {
+            pendingNodes.push_back(currentNode->left);
+        }
+
+        if (currentNode->right != nullptr) {
+            pendingNodes.push_back(currentNode->right);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Write the frozen catalog to a snapshot file, so that a later run can open
+ * it instead of parsing the csv file again.
+ *
+ * @param path - The path of the snapshot file.
+ * @param source - The stamp of the csv files the courses were loaded from.
+ * @param optionFlags - The load options that the csv file was checked with.
+ * @return Whether or not the snapshot was written. The tree must be frozen.
+ */
+bool BinarySearchTree::SaveSnapshot(const string& path, const CatalogStamp& source, uint32_t optionFlags) const {
+    if (!frozen) {
+        return false;
+    }
+
+    return writeSnapshot(path, source, optionFlags, catalog.GetArrays(), frozenIndex.GetArrays(),
+        nameIndex.GetArrays(), graph.GetArrays());
+}
+
+/**
+ * Replace the tree with the courses in a snapshot file. The file is mapped
+ * and read in place, so nothing is parsed and no course is allocated. The
+ * tree stays frozen until it is changed.
+ *
+ * @param path - The path of the snapshot file.
+ * @param source - The current stamp of the csv files the snapshot should have been built from.
+ * @param optionFlags - The load options that the csv file must have been checked with.
+ * @return Whether or not the snapshot was opened. The tree is empty if it was not.
+ */
+bool BinarySearchTree::OpenSnapshot(const string& path, const CatalogStamp& source, uint32_t optionFlags) {
+    Clear();
+
+    CourseCatalog::Arrays catalogArrays;
+    FrozenIndex::Arrays indexArrays;
+    NameIndex::Arrays nameArrays;
+    PrerequisiteGraph::Arrays graphArrays;
+
+    // If the snapshot is missing, damaged or stale...
+    if (!snapshotFile.Open(path, false)
+            || !readSnapshot(snapshotFile.Data(), snapshotFile.Size(), source, optionFlags,
+                catalogArrays, indexArrays, nameArrays, graphArrays)) {
+        snapshotFile.Close();
+
+        return false;
+    }
+
+    catalog.Attach(catalogArrays);
+    frozenIndex.Attach(indexArrays, catalog);
+    nameIndex.Attach(nameArrays);
+    graph.Attach(graphArrays);
+    frozen = true;
+
+#ifdef PLANNER_STATS
+    recordDepths();
+#endif
+
+    return true;
+}
+
+/**
+ * Print each course in ascending alphanumeric order.
+ * Lines are not flushed, so the caller decides when output is written.
+ *
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintSampleSchedule(ostream& out) const {
+    // Call the private method to display all courses from the BST in order.
+    printSampleSchedule(node, out);
+}
+
+/**
+ * Search for and print a specified course.
+ * 
+ * @param courseNumber - The number of the course to print.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintCourseInformation(string courseNumber, ostream& out) const {
+    // Print a recently printed course, or course number that was not found, without finding it again.
+    if (responseCache != nullptr && responseCache->Print(courseNumber, out)) {
+        return;
+    }
+
+    if (responseCache == nullptr) {
+        // Call the private method to find and print the given course number.
+        printCourseInformation(courseNumber, out);
+
+        return;
+    }
+
+    // Render the course once for the cache, then print it. Each thread reuses one stream, which is costly to construct.
+    thread_local ostringstream rendered;
+
+    rendered.str(string());
+
+    bool found = printCourseInformation(courseNumber, rendered);
+    string response = rendered.str();
+
+    out.write(response.data(), static_cast<streamsize>(response.size()));
+    responseCache->Add(courseNumber, response, found);
+}
+
+/**
+ * Search for a specified course and print only its prerequisites.
+ *
+ * @param courseNumber - The upper-case number of the course.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintPrerequisites(string courseNumber, ostream& out) const {
+    uint32_t foundCourse = findCourse(courseNumber);
+
+    // If the specified course was found...
+    if (foundCourse != CourseCatalog::noCourse) {
+        printPrerequisites(foundCourse, out);
+    }
+    else {
+        // Print a message to show that the course was not found.
+        out << "Course not found." << '\n';
+    }
+}
+
+/**
+ * Search for a specified course and print only the courses that have it as a direct prerequisite.
+ *
+ * @param courseNumber - The upper-case number of the course.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintDependents(string courseNumber, ostream& out) const {
+    // If the specified course was found...
+    if (findCourse(courseNumber) != CourseCatalog::noCourse) {
+        printDependents(courseNumber, out);
+    }
+    else {
+        // Print a message to show that the course was not found.
+        out << "Course not found." << '\n';
+    }
+}
+
+/**
+ * Print every course whose course number is between two course numbers, in order.
+ *
+ * @param firstNumber - The upper-case first course number to print, if it exists.
+ * @param lastNumber - The upper-case last course number to print, if it exists.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintCoursesInRange(string firstNumber, string lastNumber, ostream& out) const {
+    size_t printedCourses = 0;
+
+    // Print from the first course number on until a course number is past the last one.
+    visitFrom(firstNumber, [&](uint32_t courseId) {
+        string_view courseNumber = catalog.Number(courseId);
+
+        if (courseNumber > lastNumber) {
+            return false;
+        }
+
+        out << courseNumber << ", " << catalog.Name(courseId) << '\n';
+        printedCourses++;
+
+        return true;
+    });
+
+    // If no course is in the range...
+    if (printedCourses == 0) {
+        out << "No courses found." << '\n';
+    }
+}
+
+/**
+ * Print every course whose course number starts with a prefix, in order.
+ *
+ * @param prefix - The upper-case start of the course numbers to print.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintCoursesWithPrefix(string prefix, ostream& out) const {
+    size_t printedCourses = 0;
+
+    // The courses with the prefix are the ones from the prefix itself on, until one does not start with it.
+    visitFrom(prefix, [&](uint32_t courseId) {
+        string_view courseNumber = catalog.Number(courseId);
+
+        if (courseNumber.compare(0, prefix.size(), prefix) != 0) {
+            return false;
+        }
+
+        out << courseNumber << ", " << catalog.Name(courseId) << '\n';
+        printedCourses++;
+
+        return true;
+    });
+
+    // If no course starts with the prefix...
+    if (printedCourses == 0) {
+        out << "No courses found." << '\n';
+    }
+}
+
+/**
+ * Print every course whose name contains all of the specified words, in order.
+ * Words are compared without regard to case or punctuation.
+ *
+ * @param words - The words to search for, such as "data structures".
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintCoursesNamed(string words, ostream& out) const {
+    // The ranks of the matching courses in the index that was searched.
+    vector<uint32_t> ranks;
+
+    // An unfrozen tree has no indexes, so order its courses for this search only.
+    FrozenIndex unfrozenIndex;
+
+    if (!frozen) {
+        unfrozenIndex.Build(node, catalog);
+    }
+
+    const FrozenIndex& searchedIndex = frozen ? frozenIndex : unfrozenIndex;
+
+    // If the name index is up to date, search it. Otherwise, index the names for this search only.
+    if (frozen && !coursesChanged) {
+        nameIndex.Search(words, ranks);
+    }
+    else {
+        NameIndex currentNameIndex;
+
+        currentNameIndex.Build(catalog, searchedIndex);
+        currentNameIndex.Search(words, ranks);
+    }
+
+    for (uint32_t rank : ranks) {
+        uint32_t courseId = searchedIndex.At(rank);
+
+        out << catalog.Number(courseId) << ", " << catalog.Name(courseId) << '\n';
+    }
+
+    // If no course name contains every word...
+    if (ranks.empty()) {
+        out << "No courses found." << '\n';
+    }
+}
+
+/**
+ * Determine whether any course requires itself through its prerequisites.
+ */
+bool BinarySearchTree::HasPrerequisiteCycle() const {
+    bool cyclic = false;
+
+    visitGraph([&](const FrozenIndex&, const PrerequisiteGraph& prerequisiteGraph) {
+        vector<uint32_t> cycle;
+
+        cyclic = prerequisiteGraph.FindCycle(cycle);
+    });
+
+    return cyclic;
+}
+
+/**
+ * Find courses that require each other, if there are any. The courses are
+ * searched in the given order, so the cycle reported is the one that
+ * checkFileFormat reports when they are given in file order.
+ *
+ * @param courseIds - The IDs of the courses to search, as returned by Emplace.
+ * @param courseNumbers - Receives the course numbers on a cycle, each requiring
+ *                        the next, ending with the first course number again.
+ * @return Whether or not some courses require each other.
+ */
+bool BinarySearchTree::FindPrerequisiteCycle(const vector<uint32_t>& courseIds, vector<string>& courseNumbers) const {
+    PrerequisiteGraph orderedGraph;
+    vector<uint32_t> cycle;
+
+    courseNumbers.clear();
+    orderedGraph.Build(catalog, courseIds);
+
+    if (orderedGraph.FindCycle(cycle)) {
+        for (uint32_t node : cycle) {
+            courseNumbers.emplace_back(catalog.Number(courseIds[node]));
+        }
+    }
+
+    return !courseNumbers.empty();
+}
+
+/**
+ * Find whether a prerequisite names a course that was never inserted.
+ * Such a course number only has a placeholder in the catalog.
+ *
+ * @return Whether or not a prerequisite is missing.
+ */
+bool BinarySearchTree::HasMissingPrerequisites() const {
+    for (uint32_t courseId = 0; courseId < catalog.Size(); courseId++) {
+        // Removed courses are undefined too, but their numbers are no longer interned.
+        if (!catalog.IsDefined(courseId) && catalog.Find(catalog.Number(courseId)) == courseId) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Search for a specified course and print every course that must be taken
+ * before it, directly or through other prerequisites, in order.
+ *
+ * @param courseNumber - The upper-case number of the course.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintAllPrerequisites(string courseNumber, ostream& out) const {
+    uint32_t foundCourse = findCourse(courseNumber);
+
+    // If the specified course was not found...
+    if (foundCourse == CourseCatalog::noCourse) {
+        // Print a message to show that the course was not found.
+        out << "Course not found." << '\n';
+
+        return;
+    }
+
+    visitGraph([&](const FrozenIndex& graphIndex, const PrerequisiteGraph& prerequisiteGraph) {
+        // The found course is the first one in the index with its course number.
+        uint32_t rank = static_cast<uint32_t>(graphIndex.LowerBound(courseNumber));
+        vector<uint32_t> prerequisiteRanks;
+
+        prerequisiteGraph.Closure(rank, prerequisiteRanks);
+
+        out << catalog.Number(foundCourse) << ", " << catalog.Name(foundCourse) << '\n';
+        printRanks("All prerequisites", prerequisiteRanks, graphIndex, out);
+    });
+}
+
+/**
+ * Search for a specified course and print every course that must be taken
+ * after it, directly or through other prerequisites, in order.
+ *
+ * @param courseNumber - The upper-case number of the course.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintAllDependents(string courseNumber, ostream& out) const {
+    uint32_t foundCourse = findCourse(courseNumber);
+
+    // If the specified course was not found...
+    if (foundCourse == CourseCatalog::noCourse) {
+        // Print a message to show that the course was not found.
+        out << "Course not found." << '\n';
+
+        return;
+    }
+
+    visitGraph([&](const FrozenIndex& graphIndex, const PrerequisiteGraph& prerequisiteGraph) {
+        // The found course is the first one in the index with its course number.
+        uint32_t rank = static_cast<uint32_t>(graphIndex.LowerBound(courseNumber));
+        vector<uint32_t> dependentRanks;
+
+        prerequisiteGraph.DependentClosure(rank, dependentRanks);
+
+        out << catalog.Number(foundCourse) << ", " << catalog.Name(foundCourse) << '\n';
+        printRanks("All required for", dependentRanks, graphIndex, out);
+    });
+}
+
+/**
+ * Print every course in an order that it can be studied in, with each
+ * course after all of its prerequisites.
+ *
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintStudyOrder(ostream& out) const {
+    visitGraph([&](const FrozenIndex& graphIndex, const PrerequisiteGraph& prerequisiteGraph) {
+        vector<uint32_t> order;
+
+        // If some courses require each other, print the ones that can still be ordered.
+        if (!prerequisiteGraph.TopologicalOrder(order)) {
+            out << "Some courses require themselves through their prerequisites and cannot be ordered." << '\n';
+        }
+
+        for (uint32_t rank : order) {
+            uint32_t courseId = graphIndex.At(rank);
+
+            out << catalog.Number(courseId) << ", " << catalog.Name(courseId) << '\n';
+        }
+    });
+}
+
+/**
+ * Print a term-by-term plan for taking some courses and all of their
+ * prerequisites, with at most a number of courses in each term.
+ *
+ * @param courseNumbers - The upper-case numbers of the courses to plan for, separated by spaces or commas.
+ * @param termLimit - The most courses per term. It must be at least 1.
+ * @param buffers - The planner's working arrays, which are reused between plans.
+ * @param out - The stream to print to.
+ */
+void BinarySearchTree::PrintPlan(string courseNumbers, size_t termLimit, PlanBuffers& buffers, ostream& out) const {
+    vector<string_view> goals;
+    size_t position = 0;
+
+    // Split the course numbers at spaces, tabs and commas.
+    while ((position = courseNumbers.find_first_not_of(" \t,", position)) != string::npos) {
+        size_t numberEnd = courseNumbers.find_first_of(" \t,", position);
+
+        if (numberEnd == string::npos) {
+            numberEnd = courseNumbers.size();
+        }
+
+        goals.push_back(string_view(courseNumbers).substr(position, numberEnd - position));
+        position = numberEnd;
+    }
+
+    // If no course numbers were given...
+    if (goals.empty()) {
+        out << "No courses found." << '\n';
+
+        return;
+    }
+
+    for (string_view goal : goals) {
+        // If a course to plan for was not found...
+        if (findCourse(goal) == CourseCatalog::noCourse) {
+            out << "Course " << goal << " not found." << '\n';
+
+            return;
+        }
+    }
+
+    visitGraph([&](const FrozenIndex& graphIndex, const PrerequisiteGraph& prerequisiteGraph) {
+        buffers.goalNodes.clear();
+
+        // Each course is the first one in the index with its course number.
+        for (string_view goal : goals) {
+            buffers.goalNodes.push_back(static_cast<uint32_t>(graphIndex.LowerBound(goal)));
+        }
+
+        if (!prerequisiteGraph.Plan(termLimit, buffers)) {
+            out << "Some of these courses require themselves through their prerequisites and cannot be planned." << '\n';
+
+            return;
+        }
+
+        // Print each term's course numbers on one line.
+        for (size_t term = 0; term + 1 < buffers.termOffsets.size(); term++) {
+            out << "Term " << term + 1 << ": ";
+
+            for (uint32_t i = buffers.termOffsets[term]; i < buffers.termOffsets[term + 1]; i++) {
+                if (i > buffers.termOffsets[term]) {
+                    out << ", ";
+                }
+
+                out << catalog.Number(graphIndex.At(buffers.plannedNodes[i]));
+            }
+
+            out << '\n';
+        }
+    });
+}
+
+//============================================================================
+// Catalog Handle class definition
+//============================================================================
+
+/**
+ * Define a class that publishes one frozen BinarySearchTree at a time to
+ * any number of reader threads.
+ *
+ * A published tree is never changed. A writer builds or copies a new tree
+ * on its own and publishes it with one atomic pointer swap, so readers
+ * never wait and never see a half-built tree. Each reader thread owns a
+ * slot, padded to its own cache line, where it records the epoch it
+ * entered in. A replaced tree is retired with the epoch of its swap and
+ * deleted once no reader is still inside an earlier epoch.
+ */
+class CatalogHandle {
+
+public:
+    // The most reader threads that can hold a slot at once.
+    static constexpr size_t maxReaders = 64;
+
+    // The slot index returned when every slot is taken.
+    static constexpr size_t noSlot = SIZE_MAX;
+
+private:
+    // The epoch recorded by a reader that is not reading.
+    static constexpr uint64_t idleEpoch = 0;
+
+    // Define a structure to hold one reader thread's state on its own cache line.
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch;
+        atomic<bool> claimed;
+    };
+
+    // Define a structure to hold a replaced tree until no reader can still be using it.
+    struct RetiredTree {
+        BinarySearchTree* tree;
+        uint64_t epoch;
+    };
+
+    ReaderSlot readerSlots[maxReaders];
+    atomic<uint64_t> globalEpoch;
+    atomic<BinarySearchTree*> current;
+
+    // Serializes writers. Readers never take it.
+    mutex writerMutex;
+    vector<RetiredTree> retiredTrees;
+
+    void reclaim();
+
+public:
+    // Define a class that keeps the published tree alive while a reader uses it.
+    class ReadGuard {
+
+    private:
+        CatalogHandle& handle;
+        size_t slot;
+        const BinarySearchTree* tree;
+
+    public:
+        ReadGuard(CatalogHandle& catalogHandle, size_t readerSlot);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        const BinarySearchTree* Tree() const;
+        const BinarySearchTree* operator->() const;
+    };
+
+    CatalogHandle();
+    virtual ~CatalogHandle();
+    size_t AcquireReaderSlot();
+    void ReleaseReaderSlot(size_t slot);
+    const BinarySearchTree* Enter(size_t slot);
+    void Exit(size_t slot);
+    void Publish(BinarySearchTree* tree);
+    const BinarySearchTree* Current() const;
+    void Synchronize();
+};
+
+/**
+ * Default constructor
+ */
+CatalogHandle::CatalogHandle() : globalEpoch(1), current(nullptr) {
+    for (ReaderSlot& readerSlot : readerSlots) {
+        readerSlot.epoch.store(idleEpoch);
+        readerSlot.claimed.store(false);
+    }
+}
+
+/**
+ * Destructor. No reader may still be using the handle.
+ */
+CatalogHandle::~CatalogHandle() {
+    for (const RetiredTree& retiredTree : retiredTrees) {
+        delete retiredTree.tree;
+    }
+
+    delete current.load();
+}
+
+/**
+ * Delete every retired tree that no reader can still be using.
+ * The writer mutex must be held.
+ */
+void CatalogHandle::reclaim() {
+    // Find the oldest epoch that a reader is still inside.
+    uint64_t oldestEpoch = UINT64_MAX;
+
+    for (const ReaderSlot& readerSlot : readerSlots) {
+        uint64_t epoch = readerSlot.epoch.load();
+
+        if (epoch != idleEpoch) {
+            oldestEpoch = min(oldestEpoch, epoch);
+        }
+    }
+
+    // A reader that entered at or after a tree's retirement epoch loaded the tree that replaced it.
+    auto isUnused = [oldestEpoch](const RetiredTree& retiredTree) {
+        if (retiredTree.epoch <= oldestEpoch) {
+            delete retiredTree.tree;
+
+            return true;
+        }
+
+        return false;
+    };
+
+    retiredTrees.erase(remove_if(retiredTrees.begin(), retiredTrees.end(), isUnused), retiredTrees.end());
+}
+
+/**
+ * Claim a reader slot for the calling thread.
+ *
+ * @return The slot's index, or noSlot if every slot is taken.
+ */
+size_t CatalogHandle::AcquireReaderSlot() {
+    for (size_t slot = 0; slot < maxReaders; slot++) {
+        bool expected = false;
+
+        if (readerSlots[slot].claimed.compare_exchange_strong(expected, true)) {
+            return slot;
+        }
+    }
+
+    return noSlot;
+}
+
+/**
+ * Give a reader slot back once its thread stops reading.
+ *
+ * @param slot - The slot's index.
+ */
+void CatalogHandle::ReleaseReaderSlot(size_t slot) {
+    readerSlots[slot].epoch.store(idleEpoch);
+    readerSlots[slot].claimed.store(false);
+}
+
+/**
+ * Start reading the published tree. The tree stays valid until Exit().
+ * This never blocks.
+ *
+ * @param slot - The calling thread's reader slot.
+ * @return The published tree, or null if none has been published.
+ */
+const BinarySearchTree* CatalogHandle::Enter(size_t slot) {
+    // Record the epoch before loading the tree, so that a writer that swaps the tree afterwards keeps it alive.
+    readerSlots[slot].epoch.store(globalEpoch.load());
+
+    return current.load();
+}
+
+/**
+ * Stop reading the tree returned by Enter().
+ *
+ * @param slot - The calling thread's reader slot.
+ */
+void CatalogHandle::Exit(size_t slot) {
+    readerSlots[slot].epoch.store(idleEpoch, memory_order_release);
+}
+
+/**
+ * Publish a new tree in place of the current one. The replaced tree is
+ * deleted once every reader that might be using it has left.
+ *
+ * @param tree - The new tree. It must be frozen, and the handle takes ownership of it.
+ */
+void CatalogHandle::Publish(BinarySearchTree* tree) {
+    lock_guard<mutex> lock(writerMutex);
+
+    BinarySearchTree* replacedTree = current.exchange(tree);
+
+    // Readers that enter from now on see the new tree.
+    uint64_t epoch = globalEpoch.fetch_add(1) + 1;
+
+    if (replacedTree != nullptr) {
+        retiredTrees.push_back({ replacedTree, epoch });
+    }
+
+    reclaim();
+}
+
+/**
+ * Get the published tree from a writer thread, such as to copy it.
+ * It stays valid until the next Publish().
+ */
+const BinarySearchTree* CatalogHandle::Current() const {
+    return current.load();
+}
+
+/**
+ * Wait until every retired tree has been deleted.
+ */
+void CatalogHandle::Synchronize() {
+    while (true) {
+        {
+            lock_guard<mutex> lock(writerMutex);
+
+            reclaim();
+
+            if (retiredTrees.empty()) {
+                return;
+            }
+        }
+
+        this_thread::yield();
+    }
+}
+
+/**
+ * Constructor. Enter the handle for the lifetime of the guard.
+ *
+ * @param catalogHandle - The handle to read.
+ * @param readerSlot - The calling thread's reader slot.
+ */
+CatalogHandle::ReadGuard::ReadGuard(CatalogHandle& catalogHandle, size_t readerSlot) :
+        handle(catalogHandle), slot(readerSlot) {
+    tree = handle.Enter(slot);
+}
+
+/**
+ * Destructor. Exit the handle.
+ */
+CatalogHandle::ReadGuard::~ReadGuard() {
+    handle.Exit(slot);
+}
+
+/**
+ * Get the tree being read, or null if none has been published.
+ */
+const BinarySearchTree* CatalogHandle::ReadGuard::Tree() const {
+    return tree;
+}
+
+/**
+ * Access the tree being read.
+ */
+const BinarySearchTree* CatalogHandle::ReadGuard::operator->() const {
+    return tree;
+}
+
+//============================================================================
+// BufferedWriter class definition
+//============================================================================
+
+/**
+ * Define a stream buffer that collects output in one large block and
+ * writes it to a C file only when the block is full or flushed.
+ *
+ * Wrap it in an ostream and print with '\n' rather than endl, so that
+ * thousands of short lines cost a handful of writes.
+ */
+class BufferedWriter : public streambuf {
+
+private:
+    // The size of the output block.
+    static constexpr size_t bufferSize = 1 << 20;
+
+    FILE* file;
+    vector<char> buffer;
+
+    bool writeBuffer();
+
+protected:
+    int_type overflow(int_type c) override;
+    streamsize xsputn(const char* data, streamsize count) override;
+    int sync() override;
+
+public:
+    explicit BufferedWriter(FILE* aFile);
+    virtual ~BufferedWriter();
+};
+
+/**
+ * Initialize with the file to write to.
+ *
+ * @param aFile - The file to write to, such as stdout.
+ */
+BufferedWriter::BufferedWriter(FILE* aFile) :
+        file(aFile),
+        buffer(bufferSize) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+/**
+ * Destructor
+ */
+BufferedWriter::~BufferedWriter() {
+    // Write anything that is still buffered.
+    sync();
+}
+
+/**
+ * Write the buffered output to the file and empty the buffer.
+ *
+ * @return Whether every byte was written.
+ */
+bool BufferedWriter::writeBuffer() {
+    size_t pending = static_cast<size_t>(pptr() - pbase());
+    bool written = (pending == 0) || (fwrite(pbase(), 1, pending, file) == pending);
+
+    setp(buffer.data(), buffer.data() + buffer.size());
+
+    return written;
+}
+
+/**
+ * Write the full buffer and then store one more character.
+ */
+BufferedWriter::int_type BufferedWriter::overflow(int_type c) {
+    if (!writeBuffer()) {
+        return traits_type::eof();
+    }
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+/**
+ * Store a block of characters, writing the buffer each time it fills.
+ */
+streamsize BufferedWriter::xsputn(const char* data, streamsize count) {
+    streamsize remaining = count;
+
+    while (remaining > 0) {
+        streamsize space = epptr() - pptr();
+
+        if (space == 0) {
+            if (!writeBuffer()) {
+                return count - remaining;
+            }
+
+            continue;
+        }
+
+        streamsize chunk = min(space, remaining);
+
+        memcpy(pptr(), data, static_cast<size_t>(chunk));
+        pbump(static_cast<int>(chunk));
+
+        data += chunk;
+        remaining -= chunk;
+    }
+
+    return count;
+}
+
+/**
+ * Write the buffered output and flush the file.
+ */
+int BufferedWriter::sync() {
+    bool written = writeBuffer();
+
+    return (written && fflush(file) == 0) ? 0 : -1;
+}
+
+#ifndef _WIN32
+//============================================================================
+// Course Server class definition
+//============================================================================
+
+// The signal that asked the server to stop or reload, and the pipe that wakes its poll loop.
+static volatile sig_atomic_t serverSignal = 0;
+static int serverWakeFd = -1;
+
+/**
+ * Record a signal for the server's poll loop and wake it.
+ *
+ * @param signalNumber - The signal that was received.
+ */
+extern "C" void handleServerSignal(int signalNumber) {
+    serverSignal = signalNumber;
+
+    if (serverWakeFd >= 0) {
+        char signalByte = 's';
+        ssize_t ignored = write(serverWakeFd, &signalByte, 1);
+        (void)ignored;
+    }
+}
+
+/**
+ * Define a class that answers queries from many clients over a Unix domain
+ * socket, reading the catalog published by a CatalogHandle.
+ *
+ * The protocol is line based. Each request is one query line, as answered
+ * by answerQuery, and each response is the query's output followed by a
+ * blank line. Blank request lines and comments get no response. Clients
+ * may pipeline: every complete line that has arrived is answered in order
+ * and the responses are written back together. A line longer than
+ * maxLineLength closes the connection, so that a client cannot make the
+ * server hold an unbounded line.
+ *
+ * One thread polls the listening socket and every idle connection. A
+ * connection with data to read, or room for the responses it has not yet
+ * been sent, is handed to a pool of worker threads, and returns to the
+ * poll loop once the worker can make no more progress, so a connection is
+ * only ever served by one worker at a time. The sockets are non-blocking,
+ * so a client that stops reading leaves its responses buffered in its
+ * connection instead of holding a worker, and is not read from again
+ * until it has taken them.
+ */
+class CourseServer {
+
+private:
+    // The most bytes read from a connection at once.
+    static constexpr size_t readSize = 65536;
+
+    // The longest query line. A connection that sends a longer one is told so and closed.
+    static constexpr size_t maxLineLength = readSize;
+
+    // Define a structure to hold one client connection.
+    struct Connection {
+        int fd;
+
+        // The bytes received after the last complete query line.
+        string input;
+
+        // The responses, and how many of their bytes have been sent.
+        string output;
+        size_t outputSent;
+
+        // Whether to close the connection once its responses are sent.
+        bool closing;
+    };
+
+    CatalogHandle& catalogHandle;
+    string socketPath;
+    int listenFd;
+    int wakePipe[2];
+
+    // Connections with data to read, waiting for a worker.
+    mutex readyMutex;
+    condition_variable readyCondition;
+    deque<Connection*> readyConnections;
+    bool stopping;
+
+    // Connections that a worker has finished with, waiting to be polled again.
+    mutex returnedMutex;
+    vector<Connection*> returnedConnections;
+
+    // The thread that reloads the csv file on SIGHUP, and whether it is running or has another reload to do.
+    mutex reloadMutex;
+    thread reloadThread;
+    bool reloading;
+    bool reloadRequested;
+
+    void wake();
+    bool sendOutput(Connection* connection);
+    bool serveConnection(Connection* connection, size_t readerSlot, vector<char>& buffer, ostringstream& response, PlanBuffers& planBuffers);
+    void runWorker();
+    void requestReload(const string& csvPath, const LoadOptions& options);
+    void runReloads(const string& csvPath, const LoadOptions& options);
+
+public:
+    CourseServer(CatalogHandle& handle);
+    virtual ~CourseServer();
+    bool Listen(const string& path);
+    void Run(size_t workerCount, const string& csvPath, const LoadOptions& options);
+};
+
+/**
+ * Constructor
+ *
+ * @param handle - The handle that publishes the courses to answer queries from.
+ */
+CourseServer::CourseServer(CatalogHandle& handle) : catalogHandle(handle) {
+    listenFd = -1;
+    wakePipe[0] = -1;
+    wakePipe[1] = -1;
+    stopping = false;
+    reloading = false;
+    reloadRequested = false;
+}
+
+/**
+ * Destructor
+ */
+CourseServer::~CourseServer() {
+    serverWakeFd = -1;
+
+    for (int fd : { listenFd, wakePipe[0], wakePipe[1] }) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    // Remove the socket file so that the path can be used again.
+    if (listenFd >= 0) {
+        unlink(socketPath.c_str());
+    }
+}
+
+/**
+ * Wake the poll loop.
+ */
+void CourseServer::wake() {
+    char wakeByte = 'w';
+    ssize_t ignored = write(wakePipe[1], &wakeByte, 1);
+    (void)ignored;
+}
+
+/**
+ * Send as much of a connection's unsent responses as the socket takes
+ * without blocking.
+ *
+ * @param connection - The connection to send to.
+ * @return Whether the connection is still usable. It is not if the client has gone.
+ */
+bool CourseServer::sendOutput(Connection* connection) {
+    while (connection->outputSent < connection->output.size()) {
+        ssize_t count = write(connection->fd, connection->output.data() + connection->outputSent,
+                connection->output.size() - connection->outputSent);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // If the client is not reading, keep the rest until the poll loop sees room for it.
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+
+        if (count <= 0) {
+            return false;
+        }
+
+        connection->outputSent += static_cast<size_t>(count);
+    }
+
+    connection->output.clear();
+    connection->outputSent = 0;
+
+    return true;
+}
+
+/**
+ * Send a connection's unsent responses, and once they are all sent, read
+ * what it has sent and answer every complete query line.
+ *
+ * @param connection - The connection to serve.
+ * @param readerSlot - The calling worker's reader slot in the catalog handle.
+ * @param buffer - Scratch space for reading.
+ * @param response - Scratch space for the responses.
+ * @param planBuffers - Scratch space for planning schedules.
+ * @return Whether the connection is still open. It is not once the client closes it, or has been sent the reply to a line that is too long.
+ */
+bool CourseServer::serveConnection(Connection* connection, size_t readerSlot, vector<char>& buffer, ostringstream& response, PlanBuffers& planBuffers) {
+    if (!sendOutput(connection)) {
+        return false;
+    }
+
+    // Read no more queries until the client has taken the earlier responses, so its output stays bounded.
+    if (!connection->output.empty()) {
+        return true;
+    }
+
+    if (connection->closing) {
+        return false;
+    }
+
+    ssize_t received = read(connection->fd, buffer.data(), buffer.size());
+
+    // If there is nothing to read after all, wait for more.
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return true;
+    }
+
+    // If the client closed the connection or it failed...
+    if (received <= 0) {
+        return false;
+    }
+
+    connection->input.append(buffer.data(), static_cast<size_t>(received));
+
+    response.str("");
+
+    size_t lineStart = 0;
+    size_t lineEnd;
+    string line;
+
+    // Keep the published tree alive while this batch of queries reads it.
+    {
+        CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
+        while ((lineEnd = connection->input.find('\n', lineStart)) != string::npos) {
+            line.assign(connection->input, lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+
+            // Ignore the carriage return of a Windows line ending.
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            // Blank lines and comments get no response.
+            if (!isQueryLine(line)) {
+                continue;
+            }
+
+            answerQuery(reader.Tree(), line, planBuffers, response);
+
+            // A blank line ends each response.
+            response << '\n';
+        }
+    }
+
+    // Keep the incomplete last line for the next read, unless it is already too long to be a query.
+    connection->input.erase(0, lineStart);
+
+    if (connection->input.size() > maxLineLength) {
+        connection->input.clear();
+        connection->closing = true;
+        response << "Query line too long." << '\n' << '\n';
+    }
+
+    connection->output = response.str();
+
+    if (!sendOutput(connection)) {
+        return false;
+    }
+
+    return !connection->closing || !connection->output.empty();
+}
+
+/**
+ * Serve ready connections until the server stops.
+ */
+void CourseServer::runWorker() {
+    size_t readerSlot = catalogHandle.AcquireReaderSlot();
+    vector<char> buffer(readSize);
+    ostringstream response;
+    PlanBuffers planBuffers;
+
+    while (true) {
+        Connection* connection;
+
+        // Wait for a connection with data to read.
+        {
+            unique_lock<mutex> lock(readyMutex);
+
+            readyCondition.wait(lock, [this] { return stopping || !readyConnections.empty(); });
+
+            if (stopping) {
+                break;
+            }
+
+            connection = readyConnections.front();
+            readyConnections.pop_front();
+        }
+
+        // If the connection is still open, give it back to the poll loop.
+        if (serveConnection(connection, readerSlot, buffer, response, planBuffers)) {
+            lock_guard<mutex> lock(returnedMutex);
+
+            returnedConnections.push_back(connection);
+        }
+        else {
+            close(connection->fd);
+            delete connection;
+        }
+
+        wake();
+    }
+
+    catalogHandle.ReleaseReaderSlot(readerSlot);
+}
+
+/**
+ * Ask for the csv file to be reloaded, starting the reload thread unless it
+ * is already running. A request made during a reload is done after it, so
+ * the published catalog always reflects the file as of the last SIGHUP.
+ *
+ * @param csvPath - The csv file to reload.
+ * @param options - The options to reload the csv file with.
+ */
+void CourseServer::requestReload(const string& csvPath, const LoadOptions& options) {
+    lock_guard<mutex> lock(reloadMutex);
+
+    reloadRequested = true;
+
+    if (reloading) {
+        return;
+    }
+
+    // The last reload thread has already finished its work, so this only waits for it to exit.
+    if (reloadThread.joinable()) {
+        reloadThread.join();
+    }
+
+    reloading = true;
+    reloadThread = thread(&CourseServer::runReloads, this, cref(csvPath), cref(options));
+}
+
+/**
+ * Reload the csv file and publish the result until no reload is requested.
+ * This runs on its own thread, so the poll loop keeps accepting and
+ * handing out connections while the new catalog is built.
+ *
+ * @param csvPath - The csv file to reload.
+ * @param options - The options to reload the csv file with.
+ */
+void CourseServer::runReloads(const string& csvPath, const LoadOptions& options) {
+    while (true) {
+        {
+            lock_guard<mutex> lock(reloadMutex);
+
+            if (!reloadRequested) {
+                reloading = false;
+
+                return;
+            }
+
+            reloadRequested = false;
+        }
+
+        // Readers keep the old catalog until the new one is published.
+        publishCourses(catalogHandle, csvPath, options, true);
+    }
+}
+
+/**
+ * Create the listening socket.
+ *
+ * @param path - The path of the Unix domain socket. An existing socket file at the path is replaced.
+ * @return Whether or not the socket is listening.
+ */
+bool CourseServer::Listen(const string& path) {
+    sockaddr_un address;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    // If the path does not fit in the socket address...
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    if (pipe(wakePipe) != 0) {
+        return false;
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listenFd < 0) {
+        return false;
+    }
+
+    // Replace a socket file left behind by an earlier server.
+    unlink(path.c_str());
+    socketPath = path;
+
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, SOMAXCONN) != 0) {
+        close(listenFd);
+        listenFd = -1;
+
+        return false;
+    }
+
+    // Keep the poll loop from blocking in accept() when a client gives up before it is accepted.
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+
+    return true;
+}
+
+/**
+ * Serve clients until the process receives SIGINT or SIGTERM. SIGHUP
+ * reloads the csv file's changed lines on a separate thread and publishes
+ * the result, while the workers keep answering from the previous catalog.
+ *
+ * @param workerCount - The number of worker threads.
+ * @param csvPath - The csv file to reload on SIGHUP.
+ * @param options - The options to reload the csv file with.
+ */
+void CourseServer::Run(size_t workerCount, const string& csvPath, const LoadOptions& options) {
+    serverWakeFd = wakePipe[1];
+    serverSignal = 0;
+
+    signal(SIGINT, handleServerSignal);
+    signal(SIGTERM, handleServerSignal);
+    signal(SIGHUP, handleServerSignal);
+
+    // A client that disconnects early makes write() fail instead of ending the process.
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<thread> workers;
+
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&CourseServer::runWorker, this);
+    }
+
+    // The connections waiting for data or for room to send, polled after the wake pipe and the listening socket.
+    vector<Connection*> idleConnections;
+    vector<pollfd> pollFds;
+
+    while (serverSignal != SIGINT && serverSignal != SIGTERM) {
+        // Take back the connections that the workers have finished with.
+        {
+            lock_guard<mutex> lock(returnedMutex);
+
+            idleConnections.insert(idleConnections.end(), returnedConnections.begin(), returnedConnections.end());
+            returnedConnections.clear();
+        }
+
+        pollFds.clear();
+        pollFds.push_back({ wakePipe[0], POLLIN, 0 });
+        pollFds.push_back({ listenFd, POLLIN, 0 });
+
+        // A connection with unsent responses waits for room to send them, and every other one for data.
+        for (Connection* connection : idleConnections) {
+            pollFds.push_back({ connection->fd, static_cast<short>(connection->output.empty() ? POLLIN : POLLOUT), 0 });
+        }
+
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0 && errno != EINTR) {
+            break;
+        }
+
+        // Drain the wake pipe.
+        if (pollFds[0].revents & POLLIN) {
+            char wakeBytes[256];
+            ssize_t ignored = read(wakePipe[0], wakeBytes, sizeof(wakeBytes));
+            (void)ignored;
+        }
+
+        // Reload the csv file on SIGHUP, away from this thread so that clients are still served meanwhile.
+        if (serverSignal == SIGHUP) {
+            serverSignal = 0;
+            requestReload(csvPath, options);
+        }
+
+        // Accept a new client.
+        if (pollFds[1].revents & POLLIN) {
+            int clientFd = accept(listenFd, nullptr, nullptr);
+
+            if (clientFd >= 0) {
+                fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL) | O_NONBLOCK);
+                idleConnections.push_back(new Connection{ clientFd, string(), string(), 0, false });
+            }
+        }
+
+        // Hand every connection with data, room to send (or a hang-up) to the workers, and keep polling the rest.
+        size_t keptCount = 0;
+        size_t handedCount = 0;
+
+        for (size_t i = 0; i < idleConnections.size(); i++) {
+            // A connection accepted during this pass was not polled yet.
+            short events = (i + 2 < pollFds.size()) ? pollFds[i + 2].revents : 0;
+
+            if (events != 0) {
+                lock_guard<mutex> lock(readyMutex);
+
+                readyConnections.push_back(idleConnections[i]);
+                handedCount++;
+            }
+            else {
+                idleConnections[keptCount++] = idleConnections[i];
+            }
+        }
+
+        idleConnections.resize(keptCount);
+
+        if (handedCount == 1) {
+            readyCondition.notify_one();
+        }
+        else if (handedCount > 1) {
+            readyCondition.notify_all();
+        }
+    }
+
+    // Stop the workers and close every connection.
+    {
+        lock_guard<mutex> lock(readyMutex);
+
+        stopping = true;
+    }
+
+    readyCondition.notify_all();
+
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    // Let a reload that is under way finish, but start no other.
+    {
+        lock_guard<mutex> lock(reloadMutex);
+
+        reloadRequested = false;
+    }
+
+    if (reloadThread.joinable()) {
+        reloadThread.join();
+    }
+
+    idleConnections.insert(idleConnections.end(), readyConnections.begin(), readyConnections.end());
+    idleConnections.insert(idleConnections.end(), returnedConnections.begin(), returnedConnections.end());
+
+    for (Connection* connection : idleConnections) {
+        close(connection->fd);
+        delete connection;
+    }
+
+    readyConnections.clear();
+    returnedConnections.clear();
+}
+#endif
+
+//============================================================================
+// Delimiter Scanner class definition
+//============================================================================
+
+/**
+ * Find the commas and line feeds in a 64-byte block one byte at a time.
+ *
+ * @param block - The first byte of the block.
+ * @return A mask with bit k set if byte k is a delimiter.
+ */
+uint64_t scanDelimitersScalar(const char* block) {
+    uint64_t delimiters = 0;
+
+    for (size_t i = 0; i < 64; i++) {
+        if (block[i] == ',' || block[i] == '\n') {
+            delimiters |= uint64_t(1) << i;
+        }
+    }
+
+    return delimiters;
+}
+
+#ifdef PLANNER_X86_64
+/**
+ * Find the commas and line feeds in a 64-byte block 16 bytes at a time.
+ *
+ * @param block - The first byte of the block.
+ * @return A mask with bit k set if byte k is a delimiter.
+ */
+uint64_t scanDelimitersSse2(const char* block) {
+    const __m128i commas = _mm_set1_epi8(',');
+    const __m128i lineFeeds = _mm_set1_epi8('\n');
+    uint64_t delimiters = 0;
+
+    for (size_t i = 0; i < 64; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(bytes, commas), _mm_cmpeq_epi8(bytes, lineFeeds));
+
+        delimiters |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(matches))) << i;
+    }
+
+    return delimiters;
+}
+#endif
+
+#ifdef PLANNER_AVX2
+/**
+ * Find the commas and line feeds in a 64-byte block 32 bytes at a time.
+ * This is only called if the processor supports AVX2.
+ *
+ * @param block - The first byte of the block.
+ * @return A mask with bit k set if byte k is a delimiter.
+ */
+__attribute__((target("avx2"))) uint64_t scanDelimitersAvx2(const char* block) {
+    const __m256i commas = _mm256_set1_epi8(',');
+    const __m256i lineFeeds = _mm256_set1_epi8('\n');
+    uint64_t delimiters = 0;
+
+    for (size_t i = 0; i < 64; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, commas), _mm256_cmpeq_epi8(bytes, lineFeeds));
+
+        delimiters |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(matches))) << i;
+    }
+
+    return delimiters;
+}
+#endif
+
+/**
+ * Define a class that finds every comma and line feed in a csv buffer, in order.
+ *
+ * The buffer is compared 64 bytes at a time, and the positions of the
+ * delimiters in each block are kept as the bits of one mask, so finding
+ * the next delimiter is a bit scan rather than a loop over bytes. The
+ * comparisons use AVX2 or SSE2 when the processor has them, chosen once
+ * when the program starts, and single bytes otherwise.
+ */
+class DelimiterScanner {
+
+public:
+    // A function that finds the delimiters in one block.
+    typedef uint64_t (*BlockScanner)(const char* block);
+
+private:
+    static constexpr size_t blockSize = 64;
+
+    // The block being scanned, and the end of the buffer.
+    const char* blockStart;
+    const char* end;
+
+    // The delimiters in the block that have not been returned yet, one bit each.
+    uint64_t delimiters;
+
+    // The block scanner for this processor.
+    BlockScanner scanBlock;
+
+    void loadBlock();
+
+public:
+    DelimiterScanner(const char* begin, const char* end);
+    const char* Next();
+    static BlockScanner ChooseBlockScanner();
+    static const char* InstructionSet();
+};
+
+/**
+ * Start scanning a buffer.
+ *
+ * @param begin - The first byte of the buffer.
+ * @param end - One past the last byte of the buffer.
+ */
+DelimiterScanner::DelimiterScanner(const char* begin, const char* end) {
+    // The choice is made once, the first time a scanner is created.
+    static const BlockScanner chosenBlockScanner = ChooseBlockScanner();
+
+    blockStart = begin;
+    this->end = end;
+    scanBlock = chosenBlockScanner;
+    delimiters = 0;
+
+    if (begin < end) {
+        loadBlock();
+    }
+}
+
+/**
+ * Find the delimiters in the block at blockStart. The last block of the
+ * buffer is copied first, so that nothing past the end is read.
+ */
+void DelimiterScanner::loadBlock() {
+    if (static_cast<size_t>(end - blockStart) >= blockSize) {
+        delimiters = scanBlock(blockStart);
+
+        return;
+    }
+
+    char lastBlock[blockSize] = { 0 };
+
+    memcpy(lastBlock, blockStart, static_cast<size_t>(end - blockStart));
+    delimiters = scanBlock(lastBlock);
+}
+
+/**
+ * Find the next comma or line feed.
+ *
+ * @return The position of the delimiter, or the end of the buffer if there are no more.
+ */
+const char* DelimiterScanner::Next() {
+    while (delimiters == 0) {
+        // If this was the last block...
+        if (static_cast<size_t>(end - blockStart) <= blockSize) {
+            return end;
+        }
+
+        blockStart += blockSize;
+        loadBlock();
+    }
+
+    const char* delimiter = blockStart + countTrailingZeros(delimiters);
+
+    // Clear the lowest bit.
+    delimiters &= delimiters - 1;
+
+    return delimiter;
+}
+
+/**
+ * Choose the fastest block scanner that this processor supports.
+ */
+DelimiterScanner::BlockScanner DelimiterScanner::ChooseBlockScanner() {
+#ifdef PLANNER_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return scanDelimitersAvx2;
+    }
+#endif
+
+#ifdef PLANNER_X86_64
+    return scanDelimitersSse2;
+#else
+    return scanDelimitersScalar;
+#endif
+}
+
+/**
+ * Get the name of the instructions that the scanner uses on this processor.
+ */
+const char* DelimiterScanner::InstructionSet() {
+    BlockScanner blockScanner = ChooseBlockScanner();
+
+#ifdef PLANNER_AVX2
+    if (blockScanner == scanDelimitersAvx2) {
+        return "AVX2";
+    }
+#endif
+
+#ifdef PLANNER_X86_64
+    if (blockScanner == scanDelimitersSse2) {
+        return "SSE2";
+    }
+#endif
+
+    return "scalar";
+}
+
+//============================================================================
+// Static Methods
+//============================================================================
+
+/**
+* Determine whether a range of characters is empty or contains only whitespace.
+*
+* @param begin - The first character in the range.
+* @param end - One past the last character in the range.
+* @return Whether or not the range is blank.
+*/
+bool isBlank(const char* begin, const char* end) {
+    // The same characters as isspace in the C locale, without a call for each one.
+    return all_of(begin, end, [](char c) { return c == ' ' || (c >= '\t' && c <= '\r'); });
+}
+
+/**
+* Determine whether a string is empty or contains only whitespace.
+*
+* @param str - The string to check.
+* @return Whether or not the string is blank.
+*/
+bool isBlank(string_view str) {
+    return isBlank(str.data(), str.data() + str.size());
+}
+
+/**
+* Convert all the letters in a range of characters to uppercase in place.
+* Only ASCII letters are converted, as toupper does in the C locale.
+*
+* @param begin - The first character in the range.
+* @param end - One past the last character in the range.
+*/
+void toUpperCase(char* begin, char* end) {
+#ifdef PLANNER_X86_64
+    // Convert 16 characters at a time. Bytes of 0x80 and above compare as negative, so they are never letters.
+    const __m128i beforeA = _mm_set1_epi8('a' - 1);
+    const __m128i afterZ = _mm_set1_epi8('z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+
+    for (; end - begin >= 16; begin += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i lowerCase = _mm_and_si128(_mm_cmpgt_epi8(bytes, beforeA), _mm_cmplt_epi8(bytes, afterZ));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(begin), _mm_sub_epi8(bytes, _mm_and_si128(lowerCase, caseBit)));
+    }
+#endif
+
+    // Convert 8 characters at a time in a 64-bit word. The high bit of each byte of lowerCase is set for a letter from a to z.
+    const uint64_t highBits = 0x8080808080808080ULL;
+
+    for (; end - begin >= 8; begin += 8) {
+        uint64_t word;
+
+        memcpy(&word, begin, 8);
+
+        uint64_t lowBits = word & ~highBits;
+        uint64_t lowerCase = (lowBits + 0x1F1F1F1F1F1F1F1FULL) & ~(lowBits + 0x0505050505050505ULL) & ~word & highBits;
+
+        word -= lowerCase >> 2;
+        memcpy(begin, &word, 8);
+    }
+
+    // Convert the remaining characters without branching on each one.
+    for (; begin < end; begin++) {
+        *begin = static_cast<char>(*begin - (static_cast<unsigned char>(*begin - 'a') < 26 ? 0x20 : 0));
+    }
+}
+
+/**
+*  This method parses every course line in a csv buffer in a single pass.
+*  Course numbers and prerequisites are upper-cased in the buffer, and each
+*  parsed field is a view into the buffer, so nothing is copied. The buffer
+*  must outlive the parsed catalog.
+*
+*  A line is split on commas the same way getline(stream, element, ',')
+*  would split it: a trailing comma does not produce an extra empty element.
+*  Windows line endings are accepted.
+*
+*  @param data - The first byte of the csv buffer.
+*  @param size - The number of bytes in the csv buffer.
+*  @param catalog - This is the parsed catalog to store every course in file order.
+*/
+void parseCourses(char* data, size_t size, ParsedCatalog& catalog) {
+    char* position = data;
+    char* end = data + size;
+
+    // Clear the parsed catalog before adding to it.
+    catalog.courses.clear();
+    catalog.prerequisites.clear();
+    catalog.prerequisiteCourses.clear();
+
+    // Every comma and line feed is found in one pass over the buffer.
+    DelimiterScanner scanner(data, end);
+
+    // Parse each line in the buffer.
+    while (position < end) {
+        ParsedCourse newCourse;
+        newCourse.prerequisiteOffset = static_cast<uint32_t>(catalog.prerequisites.size());
+        newCourse.prerequisiteCount = 0;
+
+        int elementIndex = 0;
+        char* elementStart = position;
+        bool lineEnded = false;
+
+        // Get each element in the current line.
+        while (!lineEnded) {
+            char* elementEnd = const_cast<char*>(scanner.Next());
+
+            lineEnded = (elementEnd == end || *elementEnd == '\n');
+            position = (elementEnd < end) ? elementEnd + 1 : end;
+
+            // Do not treat the carriage return of a Windows line ending as part of the last element.
+            if (lineEnded && elementEnd > elementStart && *(elementEnd - 1) == '\r') {
+                elementEnd--;
+            }
+
+            // The course number is the first element.
+            if (elementIndex == 0) {
+                // Do not process blank lines. A line with no commas is blank if its only element is.
+                if (lineEnded && isBlank(elementStart, elementEnd)) {
+                    break;
+                }
+
+                // The letters in the course number should be uppercase for searching purposes.
+                toUpperCase(elementStart, elementEnd);
+                newCourse.courseNumber = string_view(elementStart, elementEnd - elementStart);
+            }
+            // The course name is the second element.
+            else if (elementIndex == 1) {
+                newCourse.courseName = string_view(elementStart, elementEnd - elementStart);
+            }
+            // Every other element is a prerequisite. Skip empty strings or strings of whitespace.
+            // This also skips the empty element after a trailing comma.
+            else if (!isBlank(elementStart, elementEnd)) {
+                toUpperCase(elementStart, elementEnd);
+                catalog.prerequisites.emplace_back(elementStart, elementEnd - elementStart);
+                newCourse.prerequisiteCount++;
+            }
+
+            elementIndex++;
+            elementStart = position;
+        }
+
+        // If the line was not blank...
+        if (elementIndex > 0) {
+            catalog.courses.push_back(newCourse);
+        }
+    }
+
+    PLANNER_STAT_ADD(lines, catalog.courses.size());
+}
+
+/**
+*  This method parses a csv buffer on several threads. The buffer is split
+*  into one chunk per thread on line boundaries, each chunk is parsed and
+*  upper-cased on its own thread, and the chunks are then joined in file
+*  order, so the result is identical to parseCourses.
+*
+*  @param data - The first byte of the csv buffer.
+*  @param size - The number of bytes in the csv buffer.
+*  @param catalog - This is the parsed catalog to store every course in file order.
+*  @param threadCount - The number of threads to parse with.
+*/
+void parseCoursesInParallel(char* data, size_t size, ParsedCatalog& catalog, unsigned threadCount) {
+    PLANNER_STAT_PHASE(parsePhase);
+    PLANNER_STAT_ADD(bytes, size);
+
+    // Small files are not worth starting threads for.
+    if (threadCount <= 1 || size < (1 << 20)) {
+        parseCourses(data, size, catalog);
+
+        return;
+    }
+
+    size_t chunkCount = threadCount;
+    vector<size_t> chunkStarts(chunkCount + 1);
+
+    chunkStarts[0] = 0;
+    chunkStarts[chunkCount] = size;
+
+    // Move each chunk boundary forward to the start of the next line.
+    for (size_t i = 1; i < chunkCount; i++) {
+        size_t start = max(size * i / chunkCount, chunkStarts[i - 1]);
+        const char* lineEnd = static_cast<const char*>(memchr(data + start, '\n', size - start));
+
+        chunkStarts[i] = (lineEnd == nullptr) ? size : static_cast<size_t>(lineEnd - data) + 1;
+    }
+
+    vector<ParsedCatalog> chunks(chunkCount);
+
+    // Parse every chunk at the same time. The chunks do not overlap, so each thread upper-cases its own bytes.
+    runInParallel(chunkCount, [&](size_t i) {
+        parseCourses(data + chunkStarts[i], chunkStarts[i + 1] - chunkStarts[i], chunks[i]);
+    });
+
+    joinParsedCatalogs(chunks, catalog, threadCount);
+}
+
+/**
+*  This method joins parsed catalogs into one, in order, as if their lines
+*  had been parsed from one buffer.
+*
+*  @param parts - The parsed catalogs to join.
+*  @param catalog - Receives the courses and prerequisites of every part. It must not be one of the parts.
+*  @param threadCount - The most threads to copy the parts on.
+*/
+void joinParsedCatalogs(const vector<ParsedCatalog>& parts, ParsedCatalog& catalog, unsigned threadCount) {
+    size_t partCount = parts.size();
+
+    // Find where each part's courses and prerequisites start in the joined catalog.
+    vector<size_t> courseStarts(partCount + 1, 0);
+    vector<size_t> prerequisiteStarts(partCount + 1, 0);
+
+    for (size_t i = 0; i < partCount; i++) {
+        courseStarts[i + 1] = courseStarts[i] + parts[i].courses.size();
+        prerequisiteStarts[i + 1] = prerequisiteStarts[i] + parts[i].prerequisites.size();
+    }
+
+    catalog.courses.resize(courseStarts[partCount]);
+    catalog.prerequisites.resize(prerequisiteStarts[partCount]);
+    catalog.prerequisiteCourses.clear();
+
+    size_t copyThreadCount = min<size_t>(max(threadCount, 1u), partCount);
+
+    // Copy every part into place at the same time. Each thread copies every copyThreadCount-th part.
+    runInParallel(copyThreadCount, [&](size_t thread) {
+        for (size_t i = thread; i < partCount; i += copyThreadCount) {
+            uint32_t prerequisiteStart = static_cast<uint32_t>(prerequisiteStarts[i]);
+
+            for (size_t j = 0; j < parts[i].courses.size(); j++) {
+                ParsedCourse course = parts[i].courses[j];
+
+                course.prerequisiteOffset += prerequisiteStart;
+                catalog.courses[courseStarts[i] + j] = course;
+            }
+
+            copy(parts[i].prerequisites.begin(), parts[i].prerequisites.end(),
+                catalog.prerequisites.begin() + prerequisiteStarts[i]);
+        }
+    });
+}
+
+/**
+*  This method checks that a course has both a course number and a course name.
+*
+*  @param course - The course to check.
+*
+*  @return Whether or not the course's fields are in the correct format.
+*/
+bool checkCourseFields(const ParsedCourse& course) {
+    // If there is not a course name or it's only whitespace...
+    if (isBlank(course.courseName)) {
+        // Print an error message for the missing course name.
+        cout << endl << "No course name found for " << course.courseNumber << "." << endl;
+
+        return false;
+    }
+
+    // If there is not a course number (if it's only whitespace)...
+    if (isBlank(course.courseNumber)) {
+        // Print an error message for the missing course number.
+        cout << endl << "No course number found for " << course.courseName << "." << endl;
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+*  This method prints the error for a prerequisite that is not on an
+*  earlier line than the course that requires it.
+*
+*  @param prerequisite - The prerequisite's course number.
+*  @param courseNumber - The number of the course that requires it.
+*  @param listedLater - Whether the prerequisite is on the course's line or a later one, rather than missing.
+*/
+void printMissingPrerequisite(string_view prerequisite, string_view courseNumber, bool listedLater) {
+    if (listedLater) {
+        cout << endl << "Prerequisite " << prerequisite << " must be listed before " << courseNumber << "." << endl;
+    }
+    else {
+        cout << endl << "Prerequisite " << prerequisite << " not found in the file." << endl;
+    }
+}
+
+/**
+*  This method checks the parsed courses for the correct format.
+*  Errors are reported for the first offending line in file order.
+*
+*  Course numbers are indexed in a hash map as they are visited, so each
+*  prerequisite is checked in constant time. In deferred mode, prerequisites
+*  that name a course which has not been seen yet are kept in a pending list
+*  and resolved in one batch once every course number is known.
+*
+*  Each prerequisite is resolved to the index of the first course with its
+*  course number, so the courses can be loaded without looking them up again.
+*
+*  Once every prerequisite is resolved, the prerequisite graph is checked
+*  for cycles, since no course on a cycle could ever be taken.
+*
+*  @param catalog - The courses parsed from the csv file, in file order.
+*  @param options - The options that control how prerequisites are resolved.
+*
+*  @return Whether or not the specified csv file is in the correct format or not.
+*/
+bool checkFileFormat(ParsedCatalog& catalog, const LoadOptions& options) {
+    PLANNER_STAT_PHASE(checkPhase);
+
+    // Define a structure to hold a prerequisite that could not be resolved when it was visited.
+    struct PendingPrerequisite {
+        size_t courseIndex;
+        size_t prerequisiteIndex;
+    };
+
+    const vector<ParsedCourse>& courses = catalog.courses;
+
+    // The index of the first course with each course number seen so far. The views refer to the csv file's buffer.
+    unordered_map<string_view, uint32_t> courseNumbers;
+    courseNumbers.reserve(courses.size());
+
+    catalog.prerequisiteCourses.assign(catalog.prerequisites.size(), 0);
+
+    vector<PendingPrerequisite> pendingPrerequisites;
+
+    // The index of the first course with a missing name or number, if any.
+    size_t firstInvalidCourse = courses.size();
+
+    // Check each course in the order it appeared in the file.
+    for (size_t i = 0; i < courses.size(); i++) {
+        const ParsedCourse& course = courses[i];
+
+        // Check if each prerequisite names a known course.
+        for (uint32_t j = 0; j < course.prerequisiteCount; j++) {
+            size_t prerequisiteIndex = course.prerequisiteOffset + j;
+            string_view prerequisite = catalog.prerequisites[prerequisiteIndex];
+
+            auto match = courseNumbers.find(prerequisite);
+
+            if (match != courseNumbers.end()) {
+                catalog.prerequisiteCourses[prerequisiteIndex] = match->second;
+            }
+            else {
+                // Without deferral, a prerequisite must name a course on an earlier line.
+                if (!options.deferPrerequisites) {
+                    bool listedLater = false;
+
+                    // A course number on this or a later line is in the file, just not before the course.
+                    for (size_t k = i; k < courses.size() && !listedLater; k++) {
+                        listedLater = (courses[k].courseNumber == prerequisite);
+                    }
+
+                    // Print an error message for the missing or misplaced prerequisite.
+                    printMissingPrerequisite(prerequisite, course.courseNumber, listedLater);
+
+                    return false;
+                }
+
+                // Resolve this prerequisite once every course number is known.
+                pendingPrerequisites.push_back({ i, prerequisiteIndex });
+            }
+        }
+
+        // Only the first course with a missing field is reported.
+        if (firstInvalidCourse == courses.size()) {
+            // Check the course fields silently first so that an earlier unresolved prerequisite is reported instead.
+            if (isBlank(course.courseName) || isBlank(course.courseNumber)) {
+                firstInvalidCourse = i;
+
+                if (!options.deferPrerequisites) {
+                    return checkCourseFields(course);
+                }
+            }
+        }
+
+        // Only the first course with a course number is recorded.
+        courseNumbers.emplace(course.courseNumber, static_cast<uint32_t>(i));
+    }
+
+    // Resolve every pending prerequisite in file order.
+    for (const PendingPrerequisite& pending : pendingPrerequisites) {
+        // A prerequisite after the first invalid course is never reached.
+        if (pending.courseIndex > firstInvalidCourse) {
+            break;
+        }
+
+        string_view prerequisite = catalog.prerequisites[pending.prerequisiteIndex];
+        auto match = courseNumbers.find(prerequisite);
+
+        // If the prerequisite is not one of the courses in the file...
+        if (match == courseNumbers.end()) {
+            // Print an error message for the missing prerequisite.
+            cout << endl << "Prerequisite " << prerequisite << " not found in the file." << endl;
+
+            return false;
+        }
+
+        catalog.prerequisiteCourses[pending.prerequisiteIndex] = match->second;
+    }
+
+    // Report the first course with a missing field after every earlier prerequisite was resolved.
+    if (firstInvalidCourse < courses.size()) {
+        return checkCourseFields(courses[firstInvalidCourse]);
+    }
+
+    // A course can only require an earlier line without deferral, so there can be no cycle.
+    if (options.deferPrerequisites) {
+        PrerequisiteGraph graph;
+        vector<uint32_t> cycle;
+
+        graph.Build(catalog);
+
+        // If some courses require each other...
+        if (graph.FindCycle(cycle)) {
+            // Print an error message with the courses on the cycle, each requiring the next.
+            cout << endl << "Prerequisite cycle found: ";
+
+            for (size_t i = 0; i < cycle.size(); i++) {
+                cout << (i > 0 ? " -> " : "") << courses[cycle[i]].courseNumber;
+            }
+
+            cout << "." << endl;
+
+            return false;
+        }
+    }
+
+    // If no formatting errors are found...
+    return true;
+}
+
+/**
+*  This method checks only the parsed courses that a reload would add or
+*  change, against the courses that will be loaded once it is applied.
+*  Nothing is printed, so a failure can be reported by checkFileFormat.
+*
+*  @param catalog - The courses parsed from the csv file, in file order.
+*  @param changes - The differences between the loaded courses and the csv file.
+*  @param bst - This is the BinarySearchTree that stores the loaded courses.
+*  @return Whether or not every added or changed course is in the correct format.
+*/
+bool checkChangedCourses(const ParsedCatalog& catalog, const CatalogChanges& changes, const BinarySearchTree* bst) {
+    PLANNER_STAT_PHASE(checkPhase);
+
+    // The course numbers that the reload removes.
+    unordered_map<string_view, uint32_t> removedNumbers;
+
+    for (const string& courseNumber : changes.removedCourses) {
+        removedNumbers.emplace(courseNumber, 0);
+    }
+
+    // Check the added courses first and then the changed ones. Only the result matters, not the order.
+    for (const vector<uint32_t>* affectedCourses : { &changes.insertedCourses, &changes.updatedCourses }) {
+        for (uint32_t courseIndex : *affectedCourses) {
+            const ParsedCourse& course = catalog.courses[courseIndex];
+
+            if (isBlank(course.courseName) || isBlank(course.courseNumber)) {
+                return false;
+            }
+
+            // Each prerequisite must be an added course or a loaded course that is kept.
+            for (uint32_t j = 0; j < course.prerequisiteCount; j++) {
+                string_view prerequisite = catalog.prerequisites[course.prerequisiteOffset + j];
+
+                if (changes.insertedNumbers.count(prerequisite) == 0
+                        && (!bst->Contains(prerequisite) || removedNumbers.count(prerequisite) != 0)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+*  This method prints how many courses were loaded.
+*
+*  @param numberOfLoadedCourses - The number of courses that were loaded into the BST.
+*/
+void printLoadedCourses(size_t numberOfLoadedCourses) {
+    if (numberOfLoadedCourses == 1) {
+        cout << endl << numberOfLoadedCourses << " course was loaded." << endl;
+    }
+    else {
+        cout << endl << numberOfLoadedCourses << " courses were loaded." << endl;
+    }
+}
+
+/**
+*  This method writes a snapshot of the loaded courses, unless the csv file
+*  changed while it was being read.
+*
+*  @param bst - This is the BinarySearchTree that stores all of the courses. It must be frozen.
+*  @param csvPath - This is the string path for the csv file the courses were loaded from.
+*  @param csvStamp - The stamp of the csv files before they were read, or null if they could not be read.
+*  @param options - The options that the file was checked with, including the snapshot path.
+*/
+void saveSnapshot(const BinarySearchTree* bst, const string& csvPath, const CatalogStamp* csvStamp, const LoadOptions& options) {
+    PLANNER_STAT_PHASE(snapshotPhase);
+
+    CatalogStamp loadedStamp;
+
+    if (csvStamp == nullptr || !readCatalogStamp(csvPath, loadedStamp) || !(loadedStamp == *csvStamp)
+            || !bst->SaveSnapshot(options.snapshotPath, *csvStamp, options.SnapshotFlags())) {
+        cout << "Could not write snapshot file!" << endl;
+    }
+}
+
+/**
+*  This method reads a csv file in fixed-size blocks and parses the complete
+*  lines of each block, so that only one block of the file is in memory at a
+*  time. A line longer than a block grows the block to fit it. The files of
+*  a directory are read one after another in name order.
+*
+*  @param csvPath - This is the string path for the specified csv file, or a directory of csv files.
+*  @param visit - Called with each parsed course in file order. The course's fields
+*                 are only valid during the call. Reading stops when it returns false.
+*  @return - Whether the file could be opened and read.
+*/
+template <typename Visit>
+bool readCoursesInBlocks(const string& csvPath, Visit visit) {
+    const size_t blockSize = 1 << 20;
+
+    vector<string> paths;
+
+    if (!CatalogFiles::ListFiles(csvPath, paths)) {
+        return false;
+    }
+
+    vector<char> buffer(blockSize);
+    ParsedCatalog block;
+    bool stopped = false;
+
+    // Read each file of a directory in turn, as if they were one file.
+    for (size_t i = 0; i < paths.size() && !stopped; i++) {
+        FILE* file = fopen(paths[i].c_str(), "rb");
+
+        if (file == nullptr) {
+            return false;
+        }
+
+        // The bytes at the front of the buffer that are left over from the last block's incomplete line.
+        size_t usedSize = 0;
+        bool atEnd = false;
+        bool readFailed = false;
+
+        while (!atEnd && !stopped) {
+            // If the buffer holds only part of one line, make room for the rest of it.
+            if (usedSize == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+
+            size_t readSize;
+
+            {
+                PLANNER_STAT_PHASE(readPhase);
+
+                readSize = fread(buffer.data() + usedSize, 1, buffer.size() - usedSize, file);
+            }
+
+            // A short read is the end of the file, or an error.
+            if (readSize < buffer.size() - usedSize) {
+                atEnd = true;
+                readFailed = (ferror(file) != 0);
+            }
+
+            usedSize += readSize;
+
+            // Parse up to the last line feed, or every byte at the end of the file.
+            size_t parsedSize = usedSize;
+
+            if (!atEnd) {
+                while (parsedSize > 0 && buffer[parsedSize - 1] != '\n') {
+                    parsedSize--;
+                }
+            }
+
+            {
+                PLANNER_STAT_PHASE(parsePhase);
+                PLANNER_STAT_ADD(bytes, parsedSize);
+
+                parseCourses(buffer.data(), parsedSize, block);
+            }
+
+            for (const ParsedCourse& course : block.courses) {
+                if (!visit(block, course)) {
+                    stopped = true;
+
+                    break;
+                }
+            }
+
+            // Keep the incomplete last line for the next block.
+            memmove(buffer.data(), buffer.data() + parsedSize, usedSize - parsedSize);
+            usedSize -= parsedSize;
+        }
+
+        fclose(file);
+
+        if (readFailed) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+*  This method loads the BST from a csv file in fixed-size blocks, checking
+*  and appending each course to the tree's catalog as soon as its line is
+*  parsed, so the raw text of the file is never held in memory. The courses
+*  get no tree nodes, so when the tree is frozen, its index is built from
+*  the catalog and the peak memory stays close to that of the frozen tree.
+*  The file is checked as checkFileFormat would check it and the same
+*  errors are printed.
+*
+*  Prerequisites that name a course which has not been seen yet are left as
+*  placeholders in the tree's catalog, which is the only record of them
+*  kept. At the end of the file, they must all have been defined. Only if a
+*  prerequisite is missing or a course is missing a field is the file read
+*  a second time, to report the first error in file order. To find
+*  prerequisite cycles, only the catalog ID of each line is kept.
+*
+*  @param bst - This is the BinarySearchTree that will store all of the courses. It must be empty.
+*  @param csvPath - This is the string path for the specified csv file.
+*  @param options - The options that control how the file is checked.
+*  @return - Whether the courses were successfully loaded. The tree must be discarded if not.
+*/
+bool streamCourses(BinarySearchTree* bst, const string& csvPath, const LoadOptions& options) {
+    // The index of the current course, and of the first course with a missing name or number.
+    size_t courseIndex = 0;
+    size_t firstInvalidCourse = SIZE_MAX;
+    bool valid = true;
+
+    // The catalog ID of each course in file order, which is needed to report a prerequisite cycle as checkFileFormat would.
+    vector<uint32_t> courseIds;
+
+    // Without deferral, the first prerequisite that was not on an earlier line, and the course that requires it.
+    string unlistedPrerequisite;
+    string requiringCourse;
+
+    bool read = readCoursesInBlocks(csvPath, [&](const ParsedCatalog& block, const ParsedCourse& course) {
+        const string_view* prerequisites = block.prerequisites.data() + course.prerequisiteOffset;
+
+        // Without deferral, a prerequisite must name a course on an earlier line.
+        if (!options.deferPrerequisites) {
+            for (uint32_t j = 0; j < course.prerequisiteCount; j++) {
+                if (!bst->Contains(prerequisites[j])) {
+                    // Keep the numbers, since the block they refer to is reused.
+                    unlistedPrerequisite.assign(prerequisites[j]);
+                    requiringCourse.assign(course.courseNumber);
+
+                    valid = false;
+
+                    return false;
+                }
+            }
+        }
+
+        // Only the first course with a missing field is reported.
+        if (firstInvalidCourse == SIZE_MAX && (isBlank(course.courseName) || isBlank(course.courseNumber))) {
+            firstInvalidCourse = courseIndex;
+
+            if (!options.deferPrerequisites) {
+                valid = checkCourseFields(course);
+
+                return false;
+            }
+        }
+
+        // The course gets no node. Freeze() indexes it from the catalog, so the nodes never take memory.
+        uint32_t courseId = bst->Append(course.courseNumber, course.courseName, prerequisites, course.prerequisiteCount);
+
+        if (options.deferPrerequisites) {
+            courseIds.push_back(courseId);
+        }
+
+        courseIndex++;
+
+        return true;
+    });
+
+    if (!read) {
+        cout << endl << "Could not open file!" << endl;
+
+        return false;
+    }
+
+    // If a prerequisite was not on an earlier line, read the rest of the file to find whether it is on a later one.
+    if (!unlistedPrerequisite.empty()) {
+        PLANNER_STAT_PHASE(checkPhase);
+
+        bool listedLater = false;
+
+        readCoursesInBlocks(csvPath, [&](const ParsedCatalog&, const ParsedCourse& course) {
+            listedLater = (course.courseNumber == unlistedPrerequisite);
+
+            return !listedLater;
+        });
+
+        // Print an error message for the missing or misplaced prerequisite.
+        printMissingPrerequisite(unlistedPrerequisite, requiringCourse, listedLater);
+
+        return false;
+    }
+
+    if (!valid) {
+        return false;
+    }
+
+    // If a prerequisite was never defined or a course is missing a field, read the file again to report the first error.
+    if (firstInvalidCourse != SIZE_MAX || bst->HasMissingPrerequisites()) {
+        PLANNER_STAT_PHASE(checkPhase);
+
+        courseIndex = 0;
+
+        readCoursesInBlocks(csvPath, [&](const ParsedCatalog& block, const ParsedCourse& course) {
+            for (uint32_t j = 0; j < course.prerequisiteCount; j++) {
+                string_view prerequisite = block.prerequisites[course.prerequisiteOffset + j];
+
+                if (!bst->Contains(prerequisite)) {
+                    // Print an error message for the missing prerequisite.
+                    cout << endl << "Prerequisite " << prerequisite << " not found in the file." << endl;
+
+                    return false;
+                }
+            }
+
+            // Report the first course with a missing field after every earlier prerequisite was resolved.
+            if (courseIndex == firstInvalidCourse) {
+                checkCourseFields(course);
+
+                return false;
+            }
+
+            courseIndex++;
+
+            return true;
+        });
+
+        return false;
+    }
+
+    // A course can only require an earlier line without deferral, so there can be no cycle.
+    if (options.deferPrerequisites) {
+        PLANNER_STAT_PHASE(checkPhase);
+
+        vector<string> cycle;
+
+        // If some courses require each other...
+        if (bst->FindPrerequisiteCycle(courseIds, cycle)) {
+            // Print an error message with the courses on the cycle, each requiring the next.
+            cout << endl << "Prerequisite cycle found: ";
+
+            for (size_t i = 0; i < cycle.size(); i++) {
+                cout << (i > 0 ? " -> " : "") << cycle[i];
+            }
+
+            cout << "." << endl;
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+*  This method maps the specified csv file, parses and checks it, and loads the BST with its courses.
+*
+*  When a snapshot path is set and the snapshot is up to date with the csv
+*  file, the snapshot is opened instead and the csv file is not read at all.
+*  Otherwise the snapshot is written after the csv file is loaded.
+*
+*  @param bst - This is the BinarySearchTree that will store all of the courses.
+*  @param csvPath - This is the string path for the specified csv file.
+*  @param options - The options that control how the file is checked.
+*  @return - Whether the courses were successfully loaded.
+*/
+bool loadCourses(BinarySearchTree* bst, string csvPath, const LoadOptions& options) {
+    bst->SetResponseCacheSize(options.responseCacheSize);
+
+    // The stamp of the csv files before they are read. Stamping hashes every file, so it is only done for a snapshot.
+    CatalogStamp csvStamp;
+    bool csvStamped = !options.snapshotPath.empty() && readCatalogStamp(csvPath, csvStamp);
+
+    // If the snapshot of this csv file is up to date, use it instead of parsing the file.
+    if (!options.snapshotPath.empty() && csvStamped
+            && bst->OpenSnapshot(options.snapshotPath, csvStamp, options.SnapshotFlags())) {
+        printLoadedCourses(bst->Size());
+
+        return true;
+    }
+
+    // In streaming mode, only one block of the file is read at a time and each course is inserted as it is parsed.
+    if (options.streaming) {
+        if (!streamCourses(bst, csvPath, options)) {
+            cout << endl << "Incorrect file format." << endl;
+
+            return false;
+        }
+
+        // The catalog is read-only until the next load, so compact it for lookups.
+        bst->Freeze();
+
+        printLoadedCourses(bst->Size());
+
+        // Save a snapshot for the next run.
+        if (!options.snapshotPath.empty()) {
+            saveSnapshot(bst, csvPath, csvStamped ? &csvStamp : nullptr, options);
+        }
+
+        return true;
+    }
+
+    // The csv file, or each csv file of a directory.
+    CatalogFiles csvFiles;
+
+    // This is the parsed catalog that stores every course line from the csv files.
+    ParsedCatalog parsedCatalog;
+
+#ifdef PLANNER_COUNT_ALLOCATIONS
+    size_t allocationsBeforeParsing = allocationCount.load(memory_order_relaxed);
+#endif
+
+    // Parse the course lines in a single pass over each file. The parsed fields refer to the mapped files.
+    if (!csvFiles.Open(csvPath, parsedCatalog, options.threadCount)) {
+        // Display an error message.
+        cout << endl << "Could not open file!" << endl;
+        cout << endl << "Incorrect file format." << endl;
+
+        return false;
+    }
+
+    // Check the format of the csv file before continuing.
+    if (!checkFileFormat(parsedCatalog, options)) {
+        cout << endl << "Incorrect file format." << endl;
+
+        return false;
+    }
+
+#ifdef PLANNER_COUNT_ALLOCATIONS
+    size_t allocationsBeforeInserting = allocationCount.load(memory_order_relaxed);
+#endif
+
+    // Insert every parsed course into the BST. Its fields are copied straight from the mapped file into the catalog.
+    bst->Load(parsedCatalog, options.threadCount);
+
+    // The number of courses that were loaded into the BST.
+    int numberOfLoadedCourses = static_cast<int>(parsedCatalog.courses.size());
+
+    // The raw files are no longer needed once every course has been inserted.
+    csvFiles.Close();
+
+    // The catalog is read-only until the next load, so compact it for lookups.
+    bst->Freeze();
+
+    // Print the number of courses that were loaded into the BST.
+    printLoadedCourses(numberOfLoadedCourses);
+
+    // Save a snapshot for the next run.
+    if (!options.snapshotPath.empty()) {
+        saveSnapshot(bst, csvPath, csvStamped ? &csvStamp : nullptr, options);
+    }
+
+#ifdef PLANNER_COUNT_ALLOCATIONS
+    size_t allocationsAfterInserting = allocationCount.load(memory_order_relaxed);
+
+    // Report how many allocations each phase of the load made.
+    cout << "Allocations: " << (allocationsBeforeInserting - allocationsBeforeParsing) << " while parsing, "
+         << (allocationsAfterInserting - allocationsBeforeInserting) << " while inserting." << endl;
+#endif
+
+    return true;
+}
+
+/**
+*  This method adds every loaded course outside the departments of some
+*  parsed courses to them, so that the departments can be reloaded from
+*  their own csv files as if the whole catalog had been. The other courses
+*  keep their order around the departments' lines.
+*
+*  @param otherDepartments - The tree whose other courses are added. It must not change while they are used.
+*  @param parsedCatalog - The courses of the departments, which receives every course.
+*  @param threadCount - The most threads to join the courses on.
+*/
+void addOtherDepartments(const BinarySearchTree* otherDepartments, ParsedCatalog& parsedCatalog, unsigned threadCount) {
+    vector<string_view> departments;
+
+    for (const ParsedCourse& course : parsedCatalog.courses) {
+        departments.push_back(departmentOf(course.courseNumber));
+    }
+
+    sort(departments.begin(), departments.end());
+    departments.erase(unique(departments.begin(), departments.end()), departments.end());
+
+    vector<ParsedCatalog> parts(3);
+
+    otherDepartments->ExportOtherDepartments(departments, parts[0], parts[2]);
+    parts[1] = move(parsedCatalog);
+
+    joinParsedCatalogs(parts, parsedCatalog, threadCount);
+}
+
+/**
+*  This method reloads the BST from a new version of its csv file, applying
+*  only the lines that changed instead of rebuilding every course.
+*
+*  The file is parsed and compared with the loaded courses by course
+*  number. Only the added and changed courses are checked, unless a change
+*  can affect other lines: strict prerequisite order, a duplicate course
+*  number, or a removed course that an unchanged course requires. Then the
+*  whole file is checked as in loadCourses. If the file is not in the
+*  correct format, the loaded courses are kept as they were, except when
+*  the changes close a prerequisite cycle, which is only found once they
+*  are applied. The caller then discards the tree, as publishCourses does.
+*
+*  @param bst - This is the BinarySearchTree that stores the loaded courses.
+*  @param csvPath - This is the string path for the specified csv file.
+*  @param options - The options that control how the file is checked.
+*  @param otherDepartments - If not null, the file holds only some departments, and every other
+*                            course is kept as it is in this tree, as addOtherDepartments does.
+*  @return - Whether the courses were successfully reloaded.
+*/
+bool reloadCourses(BinarySearchTree* bst, string csvPath, const LoadOptions& options, const BinarySearchTree* otherDepartments) {
+    bst->SetResponseCacheSize(options.responseCacheSize);
+
+    // The stamp of the csv files before they are read. Stamping hashes every file, so it is only done for a snapshot.
+    CatalogStamp csvStamp;
+    bool csvStamped = !options.snapshotPath.empty() && readCatalogStamp(csvPath, csvStamp);
+
+    // The csv file, or each csv file of a directory.
+    CatalogFiles csvFiles;
+
+    // This is the parsed catalog that stores every course line from the csv files.
+    ParsedCatalog parsedCatalog;
+
+    // If a file could not be opened...
+    if (!csvFiles.Open(csvPath, parsedCatalog, options.threadCount)) {
+        // Display an error message.
+        cout << endl << "Could not open file!" << endl;
+        cout << endl << "Incorrect file format." << endl;
+
+        return false;
+    }
+
+    // When only some departments are reloaded, every other course stays as it is loaded.
+    if (otherDepartments != nullptr) {
+        addOtherDepartments(otherDepartments, parsedCatalog, options.threadCount);
+    }
+
+    // Find which lines add, change or remove a course.
+    CatalogChanges changes;
+
+    bst->Diff(parsedCatalog, changes);
+
+    // Check the whole file only when a change can make an unchanged line invalid.
+    bool checkEveryCourse = !options.deferPrerequisites || changes.duplicateCourses || changes.removedPrerequisite;
+
+    // If a change is invalid, check the whole file too, so that the first error is reported as a full load would report it.
+    if (checkEveryCourse || !checkChangedCourses(parsedCatalog, changes, bst)) {
+        if (!checkFileFormat(parsedCatalog, options)) {
+            cout << endl << "Incorrect file format." << endl;
+            cout << "The loaded courses were not changed." << endl;
+
+            return false;
+        }
+    }
+
+    // Duplicate course numbers depend on line order, so load every course again.
+    if (changes.duplicateCourses) {
+        bst->Clear();
+        bst->Load(parsedCatalog, options.threadCount);
+    }
+    else {
+        for (const string& courseNumber : changes.removedCourses) {
+            bst->Remove(courseNumber);
+        }
+
+        for (uint32_t courseIndex : changes.updatedCourses) {
+            const ParsedCourse& course = parsedCatalog.courses[courseIndex];
+
+            bst->Update(course.courseNumber, course.courseName,
+                parsedCatalog.prerequisites.data() + course.prerequisiteOffset, course.prerequisiteCount);
+        }
+
+        for (uint32_t courseIndex : changes.insertedCourses) {
+            const ParsedCourse& course = parsedCatalog.courses[courseIndex];
+
+            bst->Emplace(course.courseNumber, course.courseName,
+                parsedCatalog.prerequisites.data() + course.prerequisiteOffset, course.prerequisiteCount);
+        }
+    }
+
+    // Rebuild the frozen index if a course was added or removed. Changed courses keep their places.
+    bst->Freeze();
+
+    // Added and changed prerequisites can close a cycle. Check the whole file to report it as a full load would.
+    if (!checkEveryCourse && (!changes.insertedCourses.empty() || !changes.updatedCourses.empty())
+            && bst->HasPrerequisiteCycle()) {
+        checkFileFormat(parsedCatalog, options);
+
+        cout << endl << "Incorrect file format." << endl;
+        cout << "The loaded courses were not changed." << endl;
+
+        return false;
+    }
+
+    // The raw files are no longer needed once every change has been applied and checked.
+    csvFiles.Close();
+
+    printLoadedCourses(parsedCatalog.courses.size());
+
+    cout << "Reloaded: " << changes.insertedCourses.size() << " added, " << changes.updatedCourses.size()
+         << " changed, " << changes.removedCourses.size() << " removed." << endl;
+
+    // Save a snapshot for the next run. A department's file is not the whole catalog that the snapshot is stamped with.
+    if (!options.snapshotPath.empty() && otherDepartments == nullptr) {
+        saveSnapshot(bst, csvPath, csvStamped ? &csvStamp : nullptr, options);
+    }
+
+    return true;
+}
+
+/**
+*  This method loads courses into a new BinarySearchTree and publishes it
+*  in place of the current one. Readers keep using the published tree until
+*  the new one is complete, and it is left published if the load fails.
+*  An incremental reload only parses and checks the changed lines, but still
+*  takes time in proportion to the whole catalog: the published tree's
+*  arrays are copied, its name index and graph are rebuilt, and adding or
+*  removing a course also rebuilds its nodes and frozen index.
+*
+*  @param catalogHandle - The handle that publishes the loaded courses.
+*  @param csvPath - This is the string path for the specified csv file.
+*  @param options - The options that control how the file is checked.
+*  @param incremental - Whether to apply only the lines that changed since the published tree was loaded.
+*  @return - Whether the courses were successfully loaded and published.
+*/
+bool publishCourses(CatalogHandle& catalogHandle, string csvPath, const LoadOptions& options, bool incremental) {
+    BinarySearchTree* loadedTree = new BinarySearchTree();
+    bool loaded;
+
+    // A reload changes a private copy of the published tree, never the published tree itself.
+    if (incremental && catalogHandle.Current() != nullptr && loadedTree->CopyFrom(*catalogHandle.Current())) {
+        loaded = reloadCourses(loadedTree, csvPath, options, nullptr);
+    }
+    else {
+        loaded = loadCourses(loadedTree, csvPath, options);
+    }
+
+    if (!loaded) {
+        delete loadedTree;
+
+        return false;
+    }
+
+    catalogHandle.Publish(loadedTree);
+
+    return true;
+}
+
+/**
+*  This method reloads the departments in a csv file, or a directory of
+*  them, and publishes the result in place of the current tree. The
+*  courses of every other department are kept as they are published, and
+*  prerequisites are checked across every department.
+*
+*  @param catalogHandle - The handle that publishes the loaded courses. It must have courses published.
+*  @param csvPath - This is the string path for the departments' csv file.
+*  @param options - The options that control how the file is checked.
+*  @return - Whether the departments were successfully reloaded and published.
+*/
+bool publishDepartments(CatalogHandle& catalogHandle, string csvPath, const LoadOptions& options) {
+    const BinarySearchTree* currentTree = catalogHandle.Current();
+    BinarySearchTree* loadedTree = new BinarySearchTree();
+
+    // The other departments are read from the published tree, which does not change until the new one is published.
+    if (currentTree == nullptr || !loadedTree->CopyFrom(*currentTree)
+            || !reloadCourses(loadedTree, csvPath, options, currentTree)) {
+        delete loadedTree;
+
+        return false;
+    }
+
+    catalogHandle.Publish(loadedTree);
+
+    return true;
+}
+
+/**
+*  This method determines whether a line holds a query, rather than being blank or a comment.
+*
+*  @param line - The line, without its line ending.
+*/
+bool isQueryLine(const string& line) {
+    return !isBlank(line) && line[line.find_first_not_of(" \t")] != '#';
+}
+
+/**
+*  This method answers one query against the loaded courses.
+*
+*  Commands:
+*    find <course number>           - Print a course, its prerequisites and the courses that require it, like menu option 3.
+*    prerequisites <course number>  - Print only a course's prerequisites line.
+*    list                           - Print every course in order, like menu option 2.
+*    range <first> <last>           - Print every course from the first course number to the last, in order.
+*    prefix <start>[*]              - Print every course whose course number starts with <start>, in order.
+*    search <words>                 - Print every course whose name contains all of the words, in order.
+*    dependents <course number>     - Print only the line of courses that have a course as a direct prerequisite.
+*    requires <course number>       - Print a course and every course that must be taken before it, like menu option 7.
+*    unlocks <course number>        - Print a course and every course that requires it, directly or indirectly.
+*    order                          - Print every course after all of its prerequisites, like menu option 8.
+*    plan <limit> <course numbers>  - Print a term-by-term plan with at most <limit> courses per term, like menu option 10.
+*
+*  @param tree - This is the BinarySearchTree that stores all of the courses.
+*  @param line - The query, without its line ending. It must not be blank.
+*  @param planBuffers - The semester planner's working arrays, reused by every query on this thread.
+*  @param out - The stream to print the answer to.
+*  @return - Whether the query was understood.
+*/
+bool answerQuery(const BinarySearchTree* tree, const string& line, PlanBuffers& planBuffers, ostream& out) {
+    // Split the query into its command and argument.
+    size_t commandStart = line.find_first_not_of(" \t");
+    size_t commandEnd = line.find_first_of(" \t", commandStart);
+    string command = line.substr(commandStart, commandEnd - commandStart);
+
+    size_t argumentStart = (commandEnd == string::npos) ? string::npos : line.find_first_not_of(" \t", commandEnd);
+    size_t argumentEnd = (argumentStart == string::npos) ? string::npos : line.find_last_not_of(" \t");
+    string argument = (argumentStart == string::npos) ? "" : line.substr(argumentStart, argumentEnd - argumentStart + 1);
+
+    toUpperCase(command);
+
+    // All course number letters are converted to uppercase before storing them in the BST.
+    toUpperCase(argument);
+
+    if (command == "FIND" && !argument.empty()) {
+        tree->PrintCourseInformation(argument, out);
+    }
+    else if (command == "PREREQUISITES" && !argument.empty()) {
+        tree->PrintPrerequisites(argument, out);
+    }
+    else if (command == "LIST" && argument.empty()) {
+        tree->PrintSampleSchedule(out);
+    }
+    else if (command == "RANGE" && argument.find_first_of(" \t") != string::npos) {
+        // Split the argument into the first and last course numbers.
+        size_t firstEnd = argument.find_first_of(" \t");
+        size_t lastStart = argument.find_first_not_of(" \t", firstEnd);
+
+        // If there are more than two course numbers...
+        if (argument.find_first_of(" \t", lastStart) != string::npos) {
+            out << "Unknown query: " << line << '\n';
+
+            return false;
+        }
+
+        tree->PrintCoursesInRange(argument.substr(0, firstEnd), argument.substr(lastStart), out);
+    }
+    else if (command == "DEPENDENTS" && !argument.empty()) {
+        tree->PrintDependents(argument, out);
+    }
+    else if (command == "REQUIRES" && !argument.empty()) {
+        tree->PrintAllPrerequisites(argument, out);
+    }
+    else if (command == "UNLOCKS" && !argument.empty()) {
+        tree->PrintAllDependents(argument, out);
+    }
+    else if (command == "ORDER" && argument.empty()) {
+        tree->PrintStudyOrder(out);
+    }
+    else if (command == "PLAN" && argument.find_first_of(" \t") != string::npos) {
+        // Split the argument into the term limit and the course numbers.
+        size_t limitEnd = argument.find_first_of(" \t");
+        string limit = argument.substr(0, limitEnd);
+
+        // If the term limit is not a positive integer...
+        if (limit.find_first_not_of("0123456789") != string::npos || limit.size() > 9 || stoul(limit) == 0) {
+            out << "Unknown query: " << line << '\n';
+
+            return false;
+        }
+
+        tree->PrintPlan(argument.substr(limitEnd), stoul(limit), planBuffers, out);
+    }
+    else if (command == "SEARCH" && !argument.empty()) {
+        tree->PrintCoursesNamed(argument, out);
+    }
+    else if (command == "PREFIX" && !argument.empty()) {
+        // A trailing * is allowed, as in CSCI3*.
+        if (argument.back() == '*') {
+            argument.pop_back();
+        }
+
+        tree->PrintCoursesWithPrefix(argument, out);
+    }
+    else {
+        out << "Unknown query: " << line << '\n';
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+*  This method answers a stream of queries against the loaded courses, one per line.
+*  The commands are the ones answerQuery understands. Blank lines and lines
+*  starting with # are ignored.
+*
+*  Each query reads the tree that is published when it starts, so a reload
+*  published by another thread takes effect from the next query.
+*
+*  @param catalogHandle - The handle that publishes the loaded courses.
+*  @param readerSlot - The calling thread's reader slot in the handle.
+*  @param queries - The stream of queries.
+*  @param out - The stream to print the answers to. It is never flushed per line.
+*  @return - The number of queries that could not be understood.
+*/
+int runBatch(CatalogHandle& catalogHandle, size_t readerSlot, istream& queries, ostream& out) {
+    string line;
+    int failedQueries = 0;
+
+    // Every plan in the batch reuses the same working arrays.
+    PlanBuffers planBuffers;
+
+    // Answer each query in order.
+    while (getline(queries, line)) {
+        // Ignore the carriage return of a Windows line ending.
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        // Skip blank lines and comments.
+        if (!isQueryLine(line)) {
+            continue;
+        }
+
+        // Keep the published tree alive while this query reads it.
+        CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
+        if (!answerQuery(reader.Tree(), line, planBuffers, out)) {
+            failedQueries++;
+        }
+    }
+
+    return failedQueries;
+}
+
+/**
+*  This method finds a latency percentile.
+*
+*  @param latencies - The latencies in nanoseconds. They are reordered.
+*  @param fraction - The fraction of latencies at or below the percentile, such as 0.99.
+*  @return - The percentile in microseconds, or zero if there are no latencies.
+*/
+double latencyPercentile(vector<uint64_t>& latencies, double fraction) {
+    if (latencies.empty()) {
+        return 0.0;
+    }
+
+    size_t rank = min(latencies.size() - 1, static_cast<size_t>(fraction * latencies.size()));
+
+    nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+
+    return latencies[rank] / 1000.0;
+}
+
+#ifndef _WIN32
+/**
+*  This method connects to a course server's Unix domain socket.
+*
+*  @param socketPath - The path of the server's socket.
+*  @return - The connected socket, or -1 if the server could not be reached.
+*/
+int connectToServer(const string& socketPath) {
+    sockaddr_un address;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/**
+*  This method sends queries to a course server from several connections at
+*  once and prints the throughput and the latency percentiles.
+*
+*  Each connection keeps up to a fixed number of requests in flight, so the
+*  server sees pipelined requests. A request's latency is measured from when
+*  it is sent until the blank line that ends its response arrives.
+*
+*  @param socketPath - The path of the server's socket.
+*  @param queriesPath - The file of queries to send, one per line. They are sent in turn, repeating as needed.
+*  @param connectionCount - The number of connections.
+*  @param pipelineDepth - The most requests each connection has in flight.
+*  @param requestCount - The total number of requests to send.
+*  @return - The exit status: zero if every request was answered.
+*/
+int runLoadGenerator(const string& socketPath, const string& queriesPath, size_t connectionCount,
+        size_t pipelineDepth, size_t requestCount) {
+    ifstream queryFile(queriesPath);
+
+    if (!queryFile.is_open()) {
+        cout << endl << "Could not open file!" << endl;
+
+        return 1;
+    }
+
+    vector<string> queries;
+    string line;
+
+    while (getline(queryFile, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        // Blank lines and comments get no response, so they are not sent.
+        if (isQueryLine(line)) {
+            queries.push_back(line + '\n');
+        }
+    }
+
+    if (queries.empty()) {
+        cout << "No queries to send." << endl;
+
+        return 1;
+    }
+
+    connectionCount = max<size_t>(connectionCount, 1);
+    pipelineDepth = max<size_t>(pipelineDepth, 1);
+
+    // The latency of every answered request in nanoseconds, per connection.
+    vector<vector<uint64_t>> latencies(connectionCount);
+    atomic<size_t> failedConnections(0);
+
+    // Ignore SIGPIPE so a server that goes away makes write() fail instead of ending the process.
+    signal(SIGPIPE, SIG_IGN);
+
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+    runInParallel(connectionCount, [&](size_t connectionIndex) {
+        // Split the requests evenly, and start each connection at a different query.
+        size_t connectionRequests = requestCount / connectionCount + (connectionIndex < requestCount % connectionCount ? 1 : 0);
+        size_t nextQuery = connectionIndex * queries.size() / connectionCount;
+
+        int fd = connectToServer(socketPath);
+
+        if (fd < 0) {
+            failedConnections++;
+
+            return;
+        }
+
+        vector<uint64_t>& connectionLatencies = latencies[connectionIndex];
+        deque<chrono::steady_clock::time_point> sendTimes;
+        vector<char> buffer(65536);
+        string requests;
+        size_t sent = 0;
+        size_t answered = 0;
+
+        // Whether the next byte received starts a line. An empty line ends a response.
+        bool atLineStart = true;
+
+        connectionLatencies.reserve(connectionRequests);
+
+        while (answered < connectionRequests) {
+            requests.clear();
+
+            // Fill the pipeline.
+            while (sent < connectionRequests && sent - answered < pipelineDepth) {
+                requests += queries[nextQuery];
+                nextQuery = (nextQuery + 1) % queries.size();
+                sendTimes.push_back(chrono::steady_clock::now());
+                sent++;
+            }
+
+            size_t written = 0;
+
+            while (written < requests.size()) {
+                ssize_t count = write(fd, requests.data() + written, requests.size() - written);
+
+                if (count <= 0) {
+                    break;
+                }
+
+                written += static_cast<size_t>(count);
+            }
+
+            ssize_t received = (written == requests.size()) ? read(fd, buffer.data(), buffer.size()) : -1;
+
+            // If the server closed the connection or it failed...
+            if (received <= 0) {
+                failedConnections++;
+                break;
+            }
+
+            chrono::steady_clock::time_point receiveTime = chrono::steady_clock::now();
+
+            for (ssize_t i = 0; i < received; i++) {
+                if (buffer[i] != '\n') {
+                    atLineStart = false;
+                }
+                else if (!atLineStart) {
+                    atLineStart = true;
+                }
+                else {
+                    // The blank line that ends the oldest outstanding response.
+                    connectionLatencies.push_back(static_cast<uint64_t>(
+                        chrono::duration_cast<chrono::nanoseconds>(receiveTime - sendTimes.front()).count()));
+                    sendTimes.pop_front();
+                    answered++;
+                }
+            }
+        }
+
+        close(fd);
+    });
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    vector<uint64_t> allLatencies;
+
+    for (const vector<uint64_t>& connectionLatencies : latencies) {
+        allLatencies.insert(allLatencies.end(), connectionLatencies.begin(), connectionLatencies.end());
+    }
+
+    double p50 = latencyPercentile(allLatencies, 0.50);
+    double p99 = latencyPercentile(allLatencies, 0.99);
+
+    cout << "Requests: " << allLatencies.size() << " answered of " << requestCount << endl;
+    cout << "Connections: " << connectionCount << " (" << failedConnections.load() << " failed), pipeline depth "
+         << pipelineDepth << endl;
+    cout << "Seconds: " << seconds << endl;
+    cout << "QPS: " << static_cast<uint64_t>(allLatencies.size() / max(seconds, 1e-9)) << endl;
+    cout << "p50 latency: " << p50 << " us" << endl;
+    cout << "p99 latency: " << p99 << " us" << endl;
+
+    return (allLatencies.size() == requestCount) ? 0 : 1;
+}
+#endif
+
+/**
+*  This method prints the statistics collected since the program started:
+*  the time and allocations of each load phase, the lines and bytes parsed,
+*  the depth of the tree, the comparisons and latencies of lookups, and the
+*  hit rate of the response cache.
+*  Statistics are only collected when the program is built with PLANNER_STATS.
+*
+*  @param out - The stream to print to.
+*/
+void printStats(ostream& out) {
+#ifdef PLANNER_STATS
+    auto load = [](const atomic<uint64_t>& counter) {
+        return counter.load(memory_order_relaxed);
+    };
+
+    uint64_t totalNanoseconds = 0;
+    uint64_t totalAllocations = 0;
+
+    out << "Load phases:" << '\n';
+
+    for (size_t phase = 0; phase < loadPhaseCount; phase++) {
+        uint64_t nanoseconds = load(plannerStats.phaseNanoseconds[phase]);
+        uint64_t allocations = load(plannerStats.phaseAllocations[phase]);
+
+        out << "  " << loadPhaseNames[phase] << ": " << nanoseconds / 1e6 << " ms";
+
+#ifdef PLANNER_COUNT_ALLOCATIONS
+        out << ", " << allocations << " allocations";
+#endif
+
+        out << '\n';
+
+        totalNanoseconds += nanoseconds;
+        totalAllocations += allocations;
+    }
+
+    out << "  Total: " << totalNanoseconds / 1e6 << " ms";
+
+#ifdef PLANNER_COUNT_ALLOCATIONS
+    out << ", " << totalAllocations << " allocations" << '\n';
+#else
+    out << '\n' << "  Allocations are only counted when the program is built with PLANNER_COUNT_ALLOCATIONS." << '\n';
+#endif
+
+    out << "Lines parsed: " << load(plannerStats.lines) << '\n';
+    out << "Bytes parsed: " << load(plannerStats.bytes) << '\n';
+
+    // Print the largest and average depth of a structure, or that it is empty.
+    auto printDepth = [&out](const char* label, uint64_t size, uint64_t maxDepth, uint64_t depthTotal) {
+        out << label << ": ";
+
+        if (size == 0) {
+            out << "empty" << '\n';
+        }
+        else {
+            out << maxDepth << " at most, " << static_cast<double>(depthTotal) / size << " on average over "
+                << size << " courses" << '\n';
+        }
+    };
+
+    printDepth("Tree depth", load(plannerStats.treeNodes), load(plannerStats.treeMaxDepth), load(plannerStats.treeDepthTotal));
+    printDepth("Index depth", load(plannerStats.indexSize), load(plannerStats.indexMaxDepth), load(plannerStats.indexDepthTotal));
+
+    uint64_t lookups = load(plannerStats.lookups);
+
+    out << "Lookups: " << lookups;
+
+    if (lookups > 0) {
+        out << ", " << static_cast<double>(load(plannerStats.lookupComparisons)) / lookups << " comparisons each";
+    }
+
+    out << '\n';
+
+    // Print every latency bucket that a lookup fell into.
+    if (lookups > 0) {
+        out << "Lookup latency:" << '\n';
+
+        for (size_t bucket = 0; bucket < latencyBucketCount; bucket++) {
+            uint64_t count = load(plannerStats.lookupLatencies[bucket]);
+
+            if (count > 0) {
+                out << "  " << (bucket == 0 ? 0 : (uint64_t(1) << bucket)) << " - " << ((uint64_t(1) << (bucket + 1)) - 1)
+                    << " ns: " << count << " (" << 100.0 * count / lookups << "%)" << '\n';
+            }
+        }
+    }
+
+    uint64_t cacheHits = load(plannerStats.cacheHits);
+    uint64_t cacheLookups = cacheHits + load(plannerStats.cacheMisses);
+
+    out << "Response cache: " << cacheHits << " hits";
+
+    if (cacheLookups > 0) {
+        out << " (" << 100.0 * cacheHits / cacheLookups << "%)";
+    }
+
+    out << ", " << load(plannerStats.cacheNegativeHits) << " of them not found, " << load(plannerStats.cacheMisses)
+        << " misses, " << load(plannerStats.cacheEvictions) << " evictions" << '\n';
+#else
+    out << "Statistics are only collected when the program is built with PLANNER_STATS." << '\n';
+#endif
+
+    out << flush;
+}
+
+/**
+*  This method prints the statistics to the standard error stream when the program exits.
+*/
+void printStatsAtExit() {
+    printStats(cerr);
+}
+
+/**
+*  This method advances a random number generator (SplitMix64). It is used
+*  instead of the standard distributions, whose results differ between
+*  standard libraries, so that generated catalogs are the same everywhere.
+*
+*  @param state - The generator's state, which is advanced.
+*  @return - The next random number.
+*/
+uint64_t nextRandom(uint64_t& state) {
+    state += 0x9E3779B97F4A7C15ULL;
+
+    uint64_t value = state;
+
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+
+    return value ^ (value >> 31);
+}
+
+/**
+*  This method writes a synthetic csv file of courses for benchmarks.
+*
+*  Course k's number sorts in position k, so each course's prerequisites
+*  are chosen from the courses before it and the catalog has no cycles.
+*
+*  @param csvPath - The path of the csv file to write.
+*  @param options - The number of courses, prerequisite fan-out, line order, name length and seed.
+*  @return - Whether the file was written.
+*/
+bool generateCatalog(const string& csvPath, const GeneratorOptions& options) {
+    bool adversarial = (options.order == "adversarial");
+
+    if (options.order != "sorted" && options.order != "shuffled" && !adversarial) {
+        cout << "Unknown order: " << options.order << ". Use sorted, shuffled or adversarial." << endl;
+
+        return false;
+    }
+
+    if (options.nameLength == 0) {
+        cout << "Course names need at least one character." << endl;
+
+        return false;
+    }
+
+    // Departments in alphabetical order, each with an equal block of course numbers.
+    static const char* const departments[] = { "ART", "BIOL", "CHEM", "CSCI", "ECON", "HIST", "MATH", "PHYS" };
+    static const size_t departmentCount = sizeof(departments) / sizeof(departments[0]);
+
+    // The words that course names are made of.
+    static const char* const nameWords[] = { "Introduction", "to", "Data", "Structures", "Algorithms", "Systems",
+        "Advanced", "Topics", "in", "Computer", "Science", "Theory", "Applied", "Methods", "Design", "Analysis",
+        "Modern", "Principles", "of", "Software" };
+    static const size_t nameWordCount = sizeof(nameWords) / sizeof(nameWords[0]);
+
+    // The digits in each course number, enough for the largest one.
+    size_t digitCount = 4;
+
+    for (size_t limit = 10000; limit < options.courseCount; limit *= 10) {
+        digitCount++;
+    }
+
+    // Write the course numbers of course k.
+    auto courseNumber = [&](size_t k) {
+        string digits = to_string(k);
+        string number = adversarial ? string("ADVERSARIALCOURSE") : string(departments[k * departmentCount / options.courseCount]);
+
+        return number + string(digitCount - digits.size(), '0') + digits;
+    };
+
+    // The order that the courses are written in.
+    vector<size_t> lineOrder(options.courseCount);
+    uint64_t randomState = options.seed;
+
+    for (size_t i = 0; i < options.courseCount; i++) {
+        lineOrder[i] = i;
+    }
+
+    if (options.order == "shuffled") {
+        for (size_t i = options.courseCount; i > 1; i--) {
+            swap(lineOrder[i - 1], lineOrder[nextRandom(randomState) % i]);
+        }
+    }
+    else if (adversarial) {
+        // Alternate between the smallest and largest remaining course numbers.
+        for (size_t i = 0; i < options.courseCount; i++) {
+            lineOrder[i] = (i % 2 == 0) ? i / 2 : options.courseCount - 1 - i / 2;
+        }
+    }
+
+    FILE* file = fopen(csvPath.c_str(), "wb");
+
+    if (file == nullptr) {
+        cout << endl << "Could not open file!" << endl;
+
+        return false;
+    }
+
+    bool written;
+
+    {
+        BufferedWriter writer(file);
+        ostream out(&writer);
+        vector<size_t> prerequisites;
+        string courseName;
+
+        for (size_t k : lineOrder) {
+            // Make the name from random words, cut to its length without a trailing space.
+            courseName.clear();
+
+            while (courseName.size() < options.nameLength) {
+                if (!courseName.empty()) {
+                    courseName += ' ';
+                }
+
+                courseName += nameWords[nextRandom(randomState) % nameWordCount];
+            }
+
+            courseName.resize(options.nameLength);
+
+            while (courseName.back() == ' ') {
+                courseName.pop_back();
+            }
+
+            out << courseNumber(k) << ',' << courseName;
+
+            // Choose up to the fan-out of distinct prerequisites from the courses before this one.
+            prerequisites.clear();
+
+            if (k > 0) {
+                size_t prerequisiteCount = nextRandom(randomState) % (options.fanOut + 1);
+
+                for (size_t i = 0; i < prerequisiteCount; i++) {
+                    size_t prerequisite = nextRandom(randomState) % k;
+
+                    if (find(prerequisites.begin(), prerequisites.end(), prerequisite) == prerequisites.end()) {
+                        prerequisites.push_back(prerequisite);
+                        out << ',' << courseNumber(prerequisite);
+                    }
+                }
+            }
+
+            out << '\n';
+        }
+
+        out.flush();
+        written = !out.fail();
+    }
+
+    written = (fclose(file) == 0) && written;
+
+    if (!written) {
+        cout << endl << "Could not write file!" << endl;
+
+        return false;
+    }
+
+    cout << options.courseCount << " courses were written to " << csvPath << "." << endl;
+
+    return true;
+}
+
+/**
+*  This method gets the most memory the process has had resident so far.
+*
+*  @return - The peak resident set size in kilobytes, or zero if it is not known.
+*/
+size_t peakResidentKilobytes() {
+#ifndef _WIN32
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#ifdef __APPLE__
+    // macOS reports bytes instead of kilobytes.
+    return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+/**
+*  This method prints a string as a JSON string, with quotes and escapes.
+*
+*  @param out - The stream to print to.
+*  @param str - The string to print.
+*/
+void printJsonString(ostream& out, const string& str) {
+    out << '"';
+
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            const char hexDigits[] = "0123456789abcdef";
+
+            out << "\\u00" << hexDigits[(c >> 4) & 0xF] << hexDigits[c & 0xF];
+        }
+        else {
+            out << c;
+        }
+    }
+
+    out << '"';
+}
+
+/**
+*  This method measures loading, inserting, finding and printing the courses
+*  of a csv file, and prints the results as one JSON object, one value per
+*  line, so that the results of two builds can be compared with diff.
+*
+*  Each phase reports its throughput, the allocations it made (when the
+*  program is built with PLANNER_COUNT_ALLOCATIONS, and null otherwise) and
+*  the peak resident memory of the process when it ended. The insert and
+*  find phases also time every operation and report latency percentiles.
+*  The popular find phase repeats a small set of courses, to measure the
+*  response cache.
+*  Printed courses go to the null device through the same buffered writer
+*  as batch mode.
+*
+*  @param csvPath - The csv file of courses, such as one written by generateCatalog.
+*  @param options - The options that the file is loaded with.
+*  @return - The exit status: zero if the courses could be loaded.
+*/
+int runBenchmark(const string& csvPath, const LoadOptions& options) {
+#ifdef PLANNER_COUNT_ALLOCATIONS
+    const bool allocationsCounted = true;
+#else
+    const bool allocationsCounted = false;
+#endif
+
+    // Parse the files once up front, for the courses to insert and the course numbers to find.
+    CatalogFiles csvFiles;
+    ParsedCatalog parsedCatalog;
+
+    if (!csvFiles.Open(csvPath, parsedCatalog, options.threadCount)) {
+        cout << endl << "Could not open file!" << endl;
+
+        return 1;
+    }
+
+    size_t courseCount = parsedCatalog.courses.size();
+
+#ifdef _WIN32
+    FILE* nullFile = fopen("NUL", "wb");
+#else
+    FILE* nullFile = fopen("/dev/null", "wb");
+#endif
+
+    if (nullFile == nullptr) {
+        cout << "Could not open the null device." << endl;
+
+        return 1;
+    }
+
+    BufferedWriter nullWriter(nullFile);
+    ostream nullOut(&nullWriter);
+    ostringstream results;
+    size_t allocationsBefore;
+
+    // Print the timing, allocations and memory of a phase that ran a number of operations.
+    auto printPhase = [&](const char* name, double seconds, size_t operationCount, const char* rateName) {
+        results << "  \"" << name << "\": {" << '\n';
+        results << "    \"seconds\": " << seconds << "," << '\n';
+        results << "    \"" << rateName << "\": " << static_cast<uint64_t>(operationCount / max(seconds, 1e-9)) << "," << '\n';
+        results << "    \"allocations\": ";
+
+        if (allocationsCounted) {
+            results << allocationCount.load(memory_order_relaxed) - allocationsBefore;
+        }
+        else {
+            results << "null";
+        }
+
+        results << "," << '\n';
+        results << "    \"peak_rss_kb\": " << peakResidentKilobytes();
+    };
+
+    // Print the latency percentiles of a phase's operations.
+    auto printLatencies = [&](vector<uint64_t>& latencies) {
+        results << "," << '\n';
+        results << "    \"p50_us\": " << latencyPercentile(latencies, 0.50) << "," << '\n';
+        results << "    \"p90_us\": " << latencyPercentile(latencies, 0.90) << "," << '\n';
+        results << "    \"p99_us\": " << latencyPercentile(latencies, 0.99) << "," << '\n';
+        results << "    \"p999_us\": " << latencyPercentile(latencies, 0.999) << "," << '\n';
+        results << "    \"max_us\": " << latencyPercentile(latencies, 1.0);
+    };
+
+    auto elapsedSeconds = [](chrono::steady_clock::time_point startTime) {
+        return chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    };
+
+    results << "{" << '\n';
+    results << "  \"catalog\": ";
+    printJsonString(results, csvPath);
+    results << "," << '\n';
+    results << "  \"courses\": " << courseCount << "," << '\n';
+    results << "  \"threads\": " << options.threadCount << "," << '\n';
+    results << "  \"instruction_set\": \"" << DelimiterScanner::InstructionSet() << "\"," << '\n';
+    results << "  \"allocations_counted\": " << (allocationsCounted ? "true" : "false") << "," << '\n';
+
+    // Load the whole file, as menu option 1 does. Its messages are kept out of the results.
+    BinarySearchTree* loadedTree = new BinarySearchTree();
+    ostringstream loadMessages;
+    streambuf* coutBuffer = cout.rdbuf(loadMessages.rdbuf());
+
+    allocationsBefore = allocationCount.load(memory_order_relaxed);
+
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    bool loaded = loadCourses(loadedTree, csvPath, options);
+    double seconds = elapsedSeconds(startTime);
+
+    cout.rdbuf(coutBuffer);
+
+    if (!loaded) {
+        cout << loadMessages.str();
+        delete loadedTree;
+        fclose(nullFile);
+
+        return 1;
+    }
+
+    printPhase("load", seconds, courseCount, "courses_per_second");
+    results << '\n' << "  }," << '\n';
+
+    // Find every course once, in a random order, as menu option 3 does.
+    vector<size_t> findOrder(courseCount);
+    uint64_t randomState = 1;
+
+    for (size_t i = 0; i < courseCount; i++) {
+        findOrder[i] = i;
+    }
+
+    for (size_t i = courseCount; i > 1; i--) {
+        swap(findOrder[i - 1], findOrder[nextRandom(randomState) % i]);
+    }
+
+    vector<uint64_t> latencies;
+    string courseNumber;
+
+    latencies.reserve(courseCount);
+    allocationsBefore = allocationCount.load(memory_order_relaxed);
+    startTime = chrono::steady_clock::now();
+
+    for (size_t i : findOrder) {
+        courseNumber.assign(parsedCatalog.courses[i].courseNumber);
+
+        chrono::steady_clock::time_point operationStart = chrono::steady_clock::now();
+
+        loadedTree->PrintCourseInformation(courseNumber, nullOut);
+        latencies.push_back(static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - operationStart).count()));
+    }
+
+    seconds = elapsedSeconds(startTime);
+    printPhase("find", seconds, courseCount, "finds_per_second");
+    printLatencies(latencies);
+    results << '\n' << "  }," << '\n';
+
+    // Find as many courses again, but nine in ten of them from the first hundredth of the random order,
+    // as a query-heavy workload does, so that the response cache can serve them.
+    size_t popularCount = max<size_t>(1, courseCount / 100);
+
+    latencies.clear();
+    allocationsBefore = allocationCount.load(memory_order_relaxed);
+    startTime = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < courseCount; i++) {
+        uint64_t random = nextRandom(randomState);
+        size_t orderIndex = (random % 10 != 0) ? (random / 10) % popularCount : (random / 10) % courseCount;
+
+        courseNumber.assign(parsedCatalog.courses[findOrder[orderIndex]].courseNumber);
+
+        chrono::steady_clock::time_point operationStart = chrono::steady_clock::now();
+
+        loadedTree->PrintCourseInformation(courseNumber, nullOut);
+        latencies.push_back(static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - operationStart).count()));
+    }
+
+    seconds = elapsedSeconds(startTime);
+    printPhase("find_popular", seconds, courseCount, "finds_per_second");
+    printLatencies(latencies);
+    results << '\n' << "  }," << '\n';
+
+    // Print every course in order, as menu option 2 does, enough times to take a measurable time.
+    size_t printCount = max<size_t>(1, 1000000 / max<size_t>(courseCount, 1));
+
+    allocationsBefore = allocationCount.load(memory_order_relaxed);
+    startTime = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < printCount; i++) {
+        loadedTree->PrintSampleSchedule(nullOut);
+    }
+
+    nullOut.flush();
+    seconds = elapsedSeconds(startTime) / printCount;
+    printPhase("print", seconds, courseCount, "courses_per_second");
+    results << '\n' << "  }," << '\n';
+
+    delete loadedTree;
+
+    // Insert every course one at a time, in file order, into an empty tree.
+    BinarySearchTree insertedTree;
+    Course course;
+
+    latencies.clear();
+    allocationsBefore = allocationCount.load(memory_order_relaxed);
+    startTime = chrono::steady_clock::now();
+
+    for (const ParsedCourse& parsedCourse : parsedCatalog.courses) {
+        course.courseNumber.assign(parsedCourse.courseNumber);
+        course.courseName.assign(parsedCourse.courseName);
+        course.prerequisites.resize(parsedCourse.prerequisiteCount);
+
+        for (uint32_t i = 0; i < parsedCourse.prerequisiteCount; i++) {
+            course.prerequisites[i].assign(parsedCatalog.prerequisites[parsedCourse.prerequisiteOffset + i]);
+        }
+
+        chrono::steady_clock::time_point operationStart = chrono::steady_clock::now();
+
+        insertedTree.Insert(course);
+        latencies.push_back(static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - operationStart).count()));
+    }
+
+    seconds = elapsedSeconds(startTime);
+    printPhase("insert", seconds, courseCount, "inserts_per_second");
+    printLatencies(latencies);
+    results << '\n' << "  }" << '\n';
+    results << "}" << '\n';
+
+    fclose(nullFile);
+    cout << results.str();
+
+    return 0;
+}
+
+/**
+*  This method writes a small csv file for the self-test.
+*
+*  @param path - The path of the file to write.
+*  @param contents - The lines of the file.
+*  @return - Whether the file was written.
+*/
+bool writeTestFile(const string& path, const string& contents) {
+    ofstream file(path, ios::binary | ios::trunc);
+
+    file << contents;
+
+    return static_cast<bool>(file);
+}
+
+/**
+*  This method answers the same queries about a tree for every course
+*  number it is given, so that two trees can be compared by their answers.
+*
+*  @param tree - The tree to query.
+*  @param courseNumbers - The course numbers to ask about, whether or not they are loaded.
+*  @return - Every answer, in order.
+*/
+string answerTestQueries(const BinarySearchTree* tree, const vector<string>& courseNumbers) {
+    PlanBuffers planBuffers;
+    ostringstream answers;
+
+    answers << tree->Size() << " courses" << '\n';
+    answerQuery(tree, "LIST", planBuffers, answers);
+    answerQuery(tree, "ORDER", planBuffers, answers);
+
+    for (const string& courseNumber : courseNumbers) {
+        answerQuery(tree, "FIND " + courseNumber, planBuffers, answers);
+        answerQuery(tree, "REQUIRES " + courseNumber, planBuffers, answers);
+        answerQuery(tree, "UNLOCKS " + courseNumber, planBuffers, answers);
+        answerQuery(tree, "DEPENDENTS " + courseNumber, planBuffers, answers);
+    }
+
+    return answers.str();
+}
+
+/**
+*  This method checks loading, reloading and snapshots against small
+*  catalogs written to a temporary directory, and prints whether each check
+*  passed. A reload must answer every query exactly as a full load of the
+*  same file does, and a rejected reload must leave the published courses
+*  as they were.
+*
+*  @param options - The options to load the catalogs with. The snapshot path is replaced.
+*  @return - Zero if every check passed, or one otherwise.
+*/
+int runSelfTest(LoadOptions options) {
+    error_code error;
+    filesystem::path directory = filesystem::temp_directory_path(error)
+        / ("planner-self-test-" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+
+    if (!filesystem::create_directories(directory, error)) {
+        cout << "Could not create a directory for the self-test." << endl;
+
+        return 1;
+    }
+
+    const string path = directory.string() + "/";
+    options.snapshotPath.clear();
+
+    size_t passedChecks = 0;
+    size_t failedChecks = 0;
+
+    // Record whether a check passed, and print it.
+    auto check = [&](const char* name, bool passed) {
+        cout << (passed ? "PASS " : "FAIL ") << name << endl;
+        (passed ? passedChecks : failedChecks)++;
+    };
+
+    // Loads print their results, which are kept here instead so that checks can read them.
+    ostringstream printed;
+
+    auto quietly = [&](auto load) {
+        printed.str(string());
+
+        streambuf* previous = cout.rdbuf(printed.rdbuf());
+        bool loaded = load();
+
+        cout.rdbuf(previous);
+
+        return loaded;
+    };
+
+    auto printedText = [&](const string& text) {
+        return printed.str().find(text) != string::npos;
+    };
+
+    // Load a file into a new handle, as a full load would, and answer the queries about it.
+    auto loadAndAnswer = [&](const string& csvPath, const vector<string>& courseNumbers) {
+        CatalogHandle freshHandle;
+
+        if (!quietly([&] { return publishCourses(freshHandle, csvPath, options, false); })) {
+            return string("not loaded");
+        }
+
+        return answerTestQueries(freshHandle.Current(), courseNumbers);
+    };
+
+    const vector<string> courseNumbers = { "CSCI100", "CSCI200", "CSCI300", "CSCI400", "MATH201", "MATH301" };
+
+    const string baseCourses =
+        "CSCI100,Introduction to Computer Science\n"
+        "CSCI200,Data Structures,CSCI100\n"
+        "MATH201,Discrete Mathematics\n"
+        "CSCI300,Introduction to Algorithms,CSCI200,MATH201\n";
+
+    writeTestFile(path + "base.csv", baseCourses);
+
+    CatalogHandle catalogHandle;
+    bool loaded = quietly([&] { return publishCourses(catalogHandle, path + "base.csv", options, false); });
+
+    check("load", loaded && catalogHandle.Current()->Size() == 4);
+
+    if (!loaded) {
+        filesystem::remove_all(directory, error);
+
+        return 1;
+    }
+
+    string baseAnswers = answerTestQueries(catalogHandle.Current(), courseNumbers);
+
+    // Add CSCI400, change CSCI200 and CSCI300, and remove MATH201, which nothing requires once CSCI300 changes.
+    writeTestFile(path + "changed.csv",
+        "CSCI100,Introduction to Computer Science\n"
+        "CSCI200,Data Structures and Algorithms,CSCI100\n"
+        "CSCI300,Introduction to Algorithms,CSCI200\n"
+        "CSCI400,Large Software Development,CSCI300,CSCI100\n");
+
+    loaded = quietly([&] { return publishCourses(catalogHandle, path + "changed.csv", options, true); });
+
+    check("reload adds, changes and removes courses",
+        loaded && printedText("Reloaded: 1 added, 2 changed, 1 removed.")
+            && answerTestQueries(catalogHandle.Current(), courseNumbers) == loadAndAnswer(path + "changed.csv", courseNumbers));
+
+    // Return to the first file, which adds MATH201 back.
+    loaded = quietly([&] { return publishCourses(catalogHandle, path + "base.csv", options, true); });
+
+    check("reload restores the first file", loaded && answerTestQueries(catalogHandle.Current(), courseNumbers) == baseAnswers);
+
+    // Switch between the files, so that each reload leaves old names, prerequisites and removed courses behind.
+    for (size_t i = 0; loaded && i < 40; i++) {
+        loaded = quietly([&] { return publishCourses(catalogHandle, path + (i % 2 == 0 ? "changed.csv" : "base.csv"), options, true); });
+    }
+
+    // The catalog is compacted along the way, so it stays near the size of a fresh load's.
+    CatalogHandle freshHandle;
+    bool saved = loaded && quietly([&] { return publishCourses(freshHandle, path + "base.csv", options, false); })
+        && catalogHandle.Current()->SaveSnapshot(path + "reloaded.snap", CatalogStamp(), 0)
+        && freshHandle.Current()->SaveSnapshot(path + "fresh.snap", CatalogStamp(), 0);
+
+    check("repeated reloads compact the catalog",
+        saved && answerTestQueries(catalogHandle.Current(), courseNumbers) == baseAnswers
+            && filesystem::file_size(path + "reloaded.snap", error) < 2 * filesystem::file_size(path + "fresh.snap", error));
+
+    // Remove MATH201 while CSCI300 still requires it.
+    writeTestFile(path + "removed.csv",
+        "CSCI100,Introduction to Computer Science\n"
+        "CSCI200,Data Structures,CSCI100\n"
+        "CSCI300,Introduction to Algorithms,CSCI200,MATH201\n");
+
+    loaded = quietly([&] { return publishCourses(catalogHandle, path + "removed.csv", options, true); });
+
+    check("reload rejects removing a required prerequisite",
+        !loaded && printedText("Prerequisite MATH201 not found in the file.")
+            && answerTestQueries(catalogHandle.Current(), courseNumbers) == baseAnswers);
+
+    // Make CSCI100 require CSCI300, which closes the cycle CSCI100 -> CSCI300 -> CSCI200 -> CSCI100.
+    writeTestFile(path + "cycle.csv",
+        "CSCI100,Introduction to Computer Science,CSCI300\n"
+        "CSCI200,Data Structures,CSCI100\n"
+        "MATH201,Discrete Mathematics\n"
+        "CSCI300,Introduction to Algorithms,CSCI200,MATH201\n");
+
+    loaded = quietly([&] { return publishCourses(catalogHandle, path + "cycle.csv", options, true); });
+
+    // The cycle is reported from any of its courses, and must name all of them and nothing else.
+    // With strict prerequisites, a cycle always has a prerequisite after its course, which is reported instead.
+    string cycle = printed.str();
+    size_t cycleStart = cycle.find("Prerequisite cycle found: ");
+    vector<string> cycleCourses;
+
+    if (cycleStart != string::npos) {
+        cycleStart += strlen("Prerequisite cycle found: ");
+        cycle = cycle.substr(cycleStart, cycle.find(".\n", cycleStart) - cycleStart);
+
+        for (size_t courseStart = 0; courseStart != string::npos; ) {
+            size_t courseEnd = cycle.find(" -> ", courseStart);
+
+            cycleCourses.push_back(cycle.substr(courseStart, courseEnd - courseStart));
+            courseStart = (courseEnd == string::npos) ? courseEnd : courseEnd + strlen(" -> ");
+        }
+    }
+
+    bool cycleClosed = (cycleCourses.size() == 4 && cycleCourses.front() == cycleCourses.back());
+
+    if (cycleClosed) {
+        cycleCourses.pop_back();
+        sort(cycleCourses.begin(), cycleCourses.end());
+    }
+
+    check("reload rejects closing a prerequisite cycle",
+        !loaded && (options.deferPrerequisites
+            ? cycleClosed && cycleCourses == vector<string>({ "CSCI100", "CSCI200", "CSCI300" })
+            : printedText("Prerequisite CSCI300 must be listed before CSCI100."))
+            && answerTestQueries(catalogHandle.Current(), courseNumbers) == baseAnswers);
+
+    // A duplicate course number keeps both lines, so a reload that adds or removes one loads the file again.
+    writeTestFile(path + "duplicate.csv", baseCourses + "CSCI200,Data Structures Again,CSCI100\n");
+
+    loaded = quietly([&] { return publishCourses(catalogHandle, path + "duplicate.csv", options, true); });
+
+    check("reload adds a duplicate course number",
+        loaded && catalogHandle.Current()->Size() == 5
+            && answerTestQueries(catalogHandle.Current(), courseNumbers) == loadAndAnswer(path + "duplicate.csv", courseNumbers));
+
+    loaded = quietly([&] { return publishCourses(catalogHandle, path + "base.csv", options, true); });
+
+    check("reload removes a duplicate course number", loaded && answerTestQueries(catalogHandle.Current(), courseNumbers) == baseAnswers);
+
+    // Reload only the MATH department: change MATH201 and add MATH301. Every CSCI course stays loaded.
+    writeTestFile(path + "math.csv",
+        "MATH201,Discrete Structures\n"
+        "MATH301,Graph Theory,MATH201\n");
+
+    writeTestFile(path + "departments.csv",
+        "CSCI100,Introduction to Computer Science\n"
+        "CSCI200,Data Structures,CSCI100\n"
+        "MATH201,Discrete Structures\n"
+        "MATH301,Graph Theory,MATH201\n"
+        "CSCI300,Introduction to Algorithms,CSCI200,MATH201\n");
+
+    loaded = quietly([&] { return publishDepartments(catalogHandle, path + "math.csv", options); });
+
+    check("department reload keeps the other departments",
+        loaded && answerTestQueries(catalogHandle.Current(), courseNumbers) == loadAndAnswer(path + "departments.csv", courseNumbers));
+
+    // A department's file must still hold every course that another department requires.
+    writeTestFile(path + "math.csv", "MATH301,Graph Theory\n");
+
+    string departmentAnswers = answerTestQueries(catalogHandle.Current(), courseNumbers);
+
+    loaded = quietly([&] { return publishDepartments(catalogHandle, path + "math.csv", options); });
+
+    check("department reload rejects removing a required prerequisite",
+        !loaded && answerTestQueries(catalogHandle.Current(), courseNumbers) == departmentAnswers);
+
+    // Write a snapshot with a full load, then open it without the csv file being parsed.
+    options.snapshotPath = path + "base.snapshot";
+
+    loaded = quietly([&] { return publishCourses(catalogHandle, path + "base.csv", options, false); });
+
+    CatalogStamp csvStamp;
+    BinarySearchTree snapshotTree;
+    bool opened = readCatalogStamp(path + "base.csv", csvStamp)
+        && snapshotTree.OpenSnapshot(options.snapshotPath, csvStamp, options.SnapshotFlags());
+
+    check("snapshot round trip", loaded && opened && answerTestQueries(&snapshotTree, courseNumbers) == baseAnswers);
+
+    snapshotTree.Clear();
+
+    // Damage one byte of a course name, then cut the last bytes off, and neither snapshot may be opened.
+    string snapshot;
+
+    {
+        ifstream snapshotFile(options.snapshotPath, ios::binary);
+        snapshot.assign(istreambuf_iterator<char>(snapshotFile), istreambuf_iterator<char>());
+    }
+
+    size_t namePosition = snapshot.find("Discrete Mathematics");
+
+    if (namePosition != string::npos) {
+        string damaged = snapshot;
+        damaged[namePosition] = 'd';
+
+        writeTestFile(path + "damaged.snapshot", damaged);
+        writeTestFile(path + "short.snapshot", snapshot.substr(0, snapshot.size() - 8));
+    }
+
+    check("snapshot rejects damaged contents",
+        namePosition != string::npos && !snapshotTree.OpenSnapshot(path + "damaged.snapshot", csvStamp, options.SnapshotFlags())
+            && !snapshotTree.OpenSnapshot(path + "short.snapshot", csvStamp, options.SnapshotFlags()));
+
+    // A load with a damaged snapshot falls back to the csv file.
+    filesystem::copy_file(path + "damaged.snapshot", options.snapshotPath, filesystem::copy_options::overwrite_existing, error);
+
+    loaded = quietly([&] { return publishCourses(catalogHandle, path + "base.csv", options, false); });
+
+    check("load ignores a damaged snapshot", loaded && answerTestQueries(catalogHandle.Current(), courseNumbers) == baseAnswers);
+
+    // A different csv file with the same size and modification time is not the one the snapshot was built from.
+    string otherCourses = baseCourses;
+
+    otherCourses[otherCourses.find("Discrete Mathematics")] = 'd';
+    writeTestFile(path + "other.csv", otherCourses);
+    filesystem::last_write_time(path + "other.csv", filesystem::last_write_time(path + "base.csv", error), error);
+
+    CatalogStamp otherStamp;
+
+    check("snapshot rejects another csv file with the same size and time",
+        snapshotTree.OpenSnapshot(options.snapshotPath, csvStamp, options.SnapshotFlags())
+            && readCatalogStamp(path + "other.csv", otherStamp)
+            && !snapshotTree.OpenSnapshot(options.snapshotPath, otherStamp, options.SnapshotFlags()));
+
+    snapshotTree.Clear();
+
+    // Each shard of a directory is stamped by name, so rewriting one with the same size and time, or renaming one, changes the stamp.
+    filesystem::create_directory(path + "shards", error);
+    writeTestFile(path + "shards/csci.csv", "CSCI100,Introduction to Computer Science\n");
+    writeTestFile(path + "shards/math.csv", "MATH100,Calculus\n");
+
+    CatalogStamp shardStamp;
+    CatalogStamp rewrittenStamp;
+    CatalogStamp renamedStamp;
+    bool stamped = readCatalogStamp(path + "shards", shardStamp);
+    filesystem::file_time_type shardTime = filesystem::last_write_time(path + "shards/math.csv", error);
+
+    writeTestFile(path + "shards/math.csv", "MATH100,Calculux\n");
+    filesystem::last_write_time(path + "shards/math.csv", shardTime, error);
+    stamped = stamped && readCatalogStamp(path + "shards", rewrittenStamp);
+
+    filesystem::rename(path + "shards/math.csv", path + "shards/maths.csv", error);
+    stamped = stamped && readCatalogStamp(path + "shards", renamedStamp);
+
+    check("directory stamp changes with a rewritten or renamed shard",
+        stamped && !(rewrittenStamp == shardStamp) && !(renamedStamp == rewrittenStamp));
+
+    options.snapshotPath.clear();
+
+    // Check range lookups, which start from the frozen index's lower bound, against a sorted list of course numbers.
+    // Some course numbers are too long to be packed in a key, and share their packed prefix.
+    uint64_t randomState = 2024;
+    vector<string> rangeNumbers;
+    string rangeCourses;
+
+    for (size_t i = 0; i < 2000; i++) {
+        const char* departments[] = { "ART", "CSCI", "MATH", "PHYSICSLABORATORY" };
+        string courseNumber = departments[nextRandom(randomState) % 4] + to_string(nextRandom(randomState) % 1000);
+
+        rangeNumbers.push_back(courseNumber);
+        rangeCourses += courseNumber + ",Course " + to_string(i) + "\n";
+    }
+
+    writeTestFile(path + "range.csv", rangeCourses);
+
+    // Duplicates are printed in file order, so keep each course's line with its number.
+    vector<pair<string, size_t>> sortedCourses;
+
+    for (size_t i = 0; i < rangeNumbers.size(); i++) {
+        sortedCourses.emplace_back(rangeNumbers[i], i);
+    }
+
+    stable_sort(sortedCourses.begin(), sortedCourses.end(),
+        [](const pair<string, size_t>& left, const pair<string, size_t>& right) { return left.first < right.first; });
+
+    for (bool streaming : { false, true }) {
+        CatalogHandle rangeHandle;
+        bool rangesMatch = true;
+
+        options.streaming = streaming;
+        loaded = quietly([&] { return publishCourses(rangeHandle, path + "range.csv", options, false); });
+
+        for (size_t i = 0; loaded && rangesMatch && i < 500; i++) {
+            // Ask from and to course numbers that are loaded, and ones just before and after them.
+            string bounds[2];
+
+            for (string& bound : bounds) {
+                bound = rangeNumbers[nextRandom(randomState) % rangeNumbers.size()];
+
+                switch (nextRandom(randomState) % 3) {
+                case 1:
+                    bound.pop_back();
+                    break;
+                case 2:
+                    bound += '5';
+                    break;
+                }
+            }
+
+            if (bounds[1] < bounds[0]) {
+                swap(bounds[0], bounds[1]);
+            }
+
+            ostringstream expected;
+
+            for (const pair<string, size_t>& course : sortedCourses) {
+                if (course.first >= bounds[0] && course.first <= bounds[1]) {
+                    expected << course.first << ", Course " << course.second << '\n';
+                }
+            }
+
+            if (expected.tellp() == 0) {
+                expected << "No courses found." << '\n';
+            }
+
+            ostringstream answer;
+
+            rangeHandle.Current()->PrintCoursesInRange(bounds[0], bounds[1], answer);
+            rangesMatch = (answer.str() == expected.str());
+        }
+
+        check(streaming ? "range lookups after a streaming load" : "range lookups", loaded && rangesMatch);
+    }
+
+    filesystem::remove_all(directory, error);
+
+    cout << endl << passedChecks << " of " << (passedChecks + failedChecks) << " checks passed." << endl;
+
+    return (failedChecks == 0) ? 0 : 1;
+}
+
+/**
+*  This method gets the department of a course number: the letters before
+*  its first digit, such as CSCI for CSCI300.
+*
+*  @param courseNumber - The course number.
+*  @return - The department, which refers to the course number.
+*/
+string_view departmentOf(string_view courseNumber) {
+    size_t digit = 0;
+
+    while (digit < courseNumber.size() && !isdigit(static_cast<unsigned char>(courseNumber[digit]))) {
+        digit++;
+    }
+
+    return courseNumber.substr(0, digit);
+}
+
+/**
+*  This method parses the number given to a command line option.
+*
+*  @param option - The option, such as --threads, for the error message.
+*  @param text - The number, which must be decimal digits only.
+*  @param maxValue - The largest number the option accepts.
+*  @param value - Receives the number if it is valid.
+*  @return - Whether the number is valid. If not, an error message is printed.
+*/
+bool parseOptionNumber(const string& option, const char* text, uint64_t maxValue, uint64_t& value) {
+    char* end = nullptr;
+
+    errno = 0;
+
+    // strtoull skips spaces and accepts a sign, so the first character must be a digit.
+    unsigned long long number = isdigit(static_cast<unsigned char>(text[0])) ? strtoull(text, &end, 10) : 0;
+
+    if (end == nullptr || *end != '\0' || errno == ERANGE || number > maxValue) {
+        cout << "Invalid number for " << option << ": " << text << " (expected 0 to " << maxValue << ")" << endl;
+
+        return false;
+    }
+
+    value = number;
+
+    return true;
+}
+
+/**
+* Convert all the letters in a given string to uppercase.
+* 
+* @param str - The string to make uppercase.
+*/
+string toUpperCase(string& str) {
+    // Loop through each character in the string and make it uppercase.
+    toUpperCase(&str[0], &str[0] + str.size());
+
+    return str;
+}
+
+/**
+ * The one and only main() method
+ */
+int main(int argc, char* argv[]) {
+    // The path of the csv file of courses.
+    string csvPath;
+
+    // The course number to find and print.
+    string courseNumber;
+
+    // The last course number of a range of courses to print.
+    string lastCourseNumber;
+
+    // The words to search the course names for.
+    string searchWords;
+
+    // The course numbers to plan semesters for, and the most courses to take per term.
+    string planCourseNumbers;
+    int termLimit = 0;
+
+    // The semester planner's working arrays, reused by every plan.
+    PlanBuffers planBuffers;
 
-/**
-*  This method checks the supplied csv file for the correct format
-*  and populates a vector of lines from the csv file.
-*
-*  @param csvPath - This is the string path for the specified csv file.
-*  @param csvLines - This is the vector to store all course lines from the csv file.
-*
-*  @return Whether or not the specified csv file is in the correct format or not.
-*/
-bool checkFileFormat(string csvPath, vector<string>& csvLines) {
-    string currentLine;
-    string courseElement;
-    vector<string> courseNumbers;
-    int elementCount;
-    ifstream csvFile;
+    // The options used when loading courses.
+    LoadOptions loadOptions;
 
-    // Try to open the specified csv file.
-    csvFile.open(csvPath);
+    // Define a handle that publishes the binary search tree holding all courses. It deletes the tree when it is destroyed.
+    CatalogHandle catalogHandle;
 
-    // If the file could not be opened...
-    if (!csvFile.is_open()) {
-        // Display an error message.
-        cout << endl << "Could not open file!" << endl;
+    // The main thread reads the published tree through its own reader slot.
+    size_t readerSlot = catalogHandle.AcquireReaderSlot();
 
-        // Do not attempt to parse the file if it cannot be opened.
-        return false;
-    }
+    // Define a boolean to determine if courses have been loaded yet.
+    bool coursesLoaded = false;
 
-    // Clear the csv lines vector before adding to it.
-    csvLines.clear();
+    // Define a boolean to determine if user input failed or not.
+    bool inputFailed = false;
+    
+    // Define a variable for the menu option. Set to 0 to enter program loop.
+    int choice = 0;
 
-    // Populate the csvLines and courseNumbers vectors.
-    while (getline(csvFile, currentLine)) {
-        // Do not process blank lines. Skip lines with only whitespace.
-        if (!all_of(currentLine.begin(), currentLine.end(), isspace)) {
-            // Store the current line of the csv file for loading courses into the BST.
-            csvLines.push_back(currentLine);
+    // The csv file and query file for batch mode. Batch mode is used when a catalog is given.
+    string batchCatalogPath;
+    string batchQueriesPath;
 
-            // Open the current line string as a stream.
-            istringstream currentLineStream(currentLine);
+    // The socket to serve the catalog on, and the number of worker threads that answer queries.
+    string serveSocketPath;
+    size_t workerCount = max(1u, thread::hardware_concurrency());
 
-            // Get the first element from the current line.
-            while (getline(currentLineStream, courseElement, ',')) {
-                // Store all encountered course numbers.
-                courseNumbers.push_back(toUpperCase(courseElement));
+    // The socket of a server to measure, and how to load it.
+    string loadgenSocketPath;
+    size_t connectionCount = 4;
+    size_t pipelineDepth = 16;
+    size_t requestCount = 100000;
 
-                // Only get the first courseElement to store in courseNumbers.
-                break;
-            }
-        }
-    }
+    // The csv file to generate and the options for generating it, and the csv file to benchmark.
+    string generatePath;
+    GeneratorOptions generatorOptions;
+    string benchCatalogPath;
 
-    // Close the file after getting all course numbers.
-    csvFile.close();
+    // Whether to print the statistics when the program exits.
+    bool statsRequested = false;
 
-    // Reopen the specified csv file.
-    csvFile.open(csvPath);
+    // Whether to check loading, reloading and snapshots instead of showing the menu.
+    bool selfTestRequested = false;
 
-    // Get each line in the csv file.
-    while (getline(csvFile, currentLine)) {
-        // Do not process blank lines. Skip lines with only whitespace.
-        if (!all_of(currentLine.begin(), currentLine.end(), isspace)) {
-            // Open the current line string as a stream.
-            istringstream currentLineStream(currentLine);
+    // The number of hardware threads, which is also the most threads that parse files and build the index.
+    const unsigned hardwareThreads = max(1u, thread::hardware_concurrency());
 
-            // The number of course elements from each line in the csv file.
-            elementCount = 0;
+    // The most connections the load generator opens, each on its own thread.
+    const size_t maxConnectionCount = 1024;
 
-            // Define a variable to hold the course number for the current line.
-            string currentCourseNumber = "";
+    // The number given to the current option.
+    uint64_t optionValue = 0;
 
-            // Define a variable to hold the course name for the current line.
-            string currentCourseName = "";
+    // Parse the command line options.
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
 
-            // Define a variable to hold a prerequisite for the current line.
-            string currentPrerequisite = "";
+        // Require every prerequisite to name a course on an earlier line of the file.
+        if (argument == "--strict-prerequisites") {
+            loadOptions.deferPrerequisites = false;
+        }
+        // Parse files and build the index on this many threads. Zero, or more than the hardware has, uses every hardware thread.
+        else if (argument == "--threads" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], UINT32_MAX, optionValue)) {
+                return 1;
+            }
 
-            // Get each element in the current line.
-            while (getline(currentLineStream, courseElement, ',')) {
-                // Increment the element count once a courseElement is retrieved.
-                elementCount++;
-            
-                // Store the current course number for the missing course name error.
-                if (elementCount == 1) {
-                    currentCourseNumber = toUpperCase(courseElement);
-                }
+            loadOptions.threadCount = (optionValue == 0) ? hardwareThreads : static_cast<unsigned>(min<uint64_t>(optionValue, hardwareThreads));
+        }
+        // Open this snapshot instead of the csv file when it is up to date, or write it after loading.
+        else if (argument == "--snapshot" && i + 1 < argc) {
+            loadOptions.snapshotPath = argv[++i];
+        }
+        // Read csv files in blocks and add each course to the catalog as it is parsed, so the raw file and tree nodes are never held.
+        else if (argument == "--streaming") {
+            loadOptions.streaming = true;
+        }
+        // Keep the rendered details of up to this many recently found courses. Zero disables the cache.
+        else if (argument == "--cache" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], 1 << 20, optionValue)) {
+                return 1;
+            }
 
-                // Store the current course number for the missing course name error.
-                if (elementCount == 2) {
-                    currentCourseName = courseElement;
-                }
+            loadOptions.responseCacheSize = static_cast<size_t>(optionValue);
+        }
+        // Load this csv file and answer queries without the menu.
+        else if (argument == "--catalog" && i + 1 < argc) {
+            batchCatalogPath = argv[++i];
+        }
+        // Read the batch queries from this file instead of standard input.
+        else if (argument == "--queries" && i + 1 < argc) {
+            batchQueriesPath = argv[++i];
+        }
+        // Serve the catalog's courses over this Unix domain socket instead of showing the menu.
+        else if (argument == "--serve" && i + 1 < argc) {
+            serveSocketPath = argv[++i];
+        }
+        // Answer server queries on this many threads. Zero uses every hardware thread.
+        else if (argument == "--workers" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], UINT32_MAX, optionValue)) {
+                return 1;
+            }
 
-                // Check if the current prerequisite exist in the file. Skip checking empty and whitespace course numbers.
-                if (elementCount > 2 && !all_of(courseElement.begin(), courseElement.end(), isspace)) {
-                    // Store the current course element as the current prerequisite.
-                    currentPrerequisite = toUpperCase(courseElement);
+            workerCount = (optionValue == 0) ? hardwareThreads : static_cast<size_t>(optionValue);
+        }
+        // Send the queries to the server on this socket and report its latency and throughput.
+        else if (argument == "--loadgen" && i + 1 < argc) {
+            loadgenSocketPath = argv[++i];
+        }
+        else if (argument == "--connections" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], maxConnectionCount, optionValue)) {
+                return 1;
+            }
 
-                    // If the prerequisite was not previously added to the vector of course numbers.
-                    if (find(courseNumbers.begin(), courseNumbers.end(), currentPrerequisite) == courseNumbers.end()) {
-                        // Print an error message for the missing prerequisite.
-                        cout << endl << "Prerequisite " << currentPrerequisite << " not found in the file." << endl;
+            connectionCount = static_cast<size_t>(optionValue);
+        }
+        else if (argument == "--pipeline" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], UINT32_MAX, optionValue)) {
+                return 1;
+            }
 
-                        return false;
-                    }
-                }
+            pipelineDepth = static_cast<size_t>(optionValue);
+        }
+        else if (argument == "--requests" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], UINT32_MAX, optionValue)) {
+                return 1;
             }
 
-            // After parsing the currentLineStream, if there is not a course name or it's only whitespace...
-            if (elementCount == 1 || all_of(currentCourseName.begin(), currentCourseName.end(), isspace)) {
-                // Print an error message for the missing course name.
-                cout << endl << "No course name found for " << currentCourseNumber << "." << endl;
+            requestCount = static_cast<size_t>(optionValue);
+        }
+        // Write a synthetic csv file of courses for benchmarks.
+        else if (argument == "--generate" && i + 1 < argc) {
+            generatePath = argv[++i];
+        }
+        else if (argument == "--courses" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], UINT32_MAX, optionValue)) {
+                return 1;
+            }
 
-                return false;
+            generatorOptions.courseCount = static_cast<size_t>(optionValue);
+        }
+        else if (argument == "--fanout" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], UINT32_MAX, optionValue)) {
+                return 1;
             }
 
-            // After parsing the currentLineStream, if there is not a course number (if it's only whitespace)...
-            if (elementCount >= 2 && all_of(currentCourseNumber.begin(), currentCourseNumber.end(), isspace)) {
-                // Print an error message for the missing course number.
-                cout << endl << "No course number found for " << currentCourseName << "." << endl;
+            generatorOptions.fanOut = static_cast<size_t>(optionValue);
+        }
+        else if (argument == "--order" && i + 1 < argc) {
+            generatorOptions.order = argv[++i];
+        }
+        else if (argument == "--name-length" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], UINT32_MAX, optionValue)) {
+                return 1;
+            }
 
-                return false;
+            generatorOptions.nameLength = static_cast<size_t>(optionValue);
+        }
+        else if (argument == "--seed" && i + 1 < argc) {
+            if (!parseOptionNumber(argument, argv[++i], UINT64_MAX, generatorOptions.seed)) {
+                return 1;
             }
         }
+        // Measure loading, finding, printing and inserting the courses of this csv file, and print the results as JSON.
+        else if (argument == "--bench" && i + 1 < argc) {
+            benchCatalogPath = argv[++i];
+        }
+        // Print the statistics to standard error when the program exits.
+        else if (argument == "--stats") {
+            statsRequested = true;
+        }
+        // Check loading, reloading and snapshots against small catalogs, and print whether each check passed.
+        else if (argument == "--self-test") {
+            selfTestRequested = true;
+        }
+        else {
+            cout << "Unknown option: " << argument << endl;
+            cout << "Usage: " << argv[0] << " [--strict-prerequisites] [--threads <count>] [--snapshot <snapshot file>] [--streaming] [--cache <entries>] [--stats]"
+                 << " [--catalog <csv file or directory> [--queries <query file>]]" << endl;
+            cout << "       " << argv[0] << " --catalog <csv file or directory> --serve <socket> [--workers <count>]" << endl;
+            cout << "       " << argv[0] << " --loadgen <socket> --queries <query file> [--connections <count>]"
+                 << " [--pipeline <depth>] [--requests <count>]" << endl;
+            cout << "       " << argv[0] << " --generate <csv file> [--courses <count>] [--fanout <count>]"
+                 << " [--order sorted|shuffled|adversarial] [--name-length <characters>] [--seed <number>]" << endl;
+            cout << "       " << argv[0] << " [--strict-prerequisites] [--threads <count>] [--cache <entries>] --bench <csv file or directory>" << endl;
+            cout << "       " << argv[0] << " [--strict-prerequisites] [--threads <count>] [--cache <entries>] --self-test" << endl;
+
+            return 1;
+        }
     }
 
-    // If no formatting errors are found...
-    return true;
-}
+    if (statsRequested) {
+#ifdef PLANNER_STATS
+        atexit(printStatsAtExit);
+#else
+        printStats(cout);
 
-/**
-*  This method loads the BST with courses from a vector of raw string lines from the specified csv file.
-*
-*  @param bst - This is the BinarySearchTree that will store all of the courses.
-*  @param csvPath - This is the string path for the specified csv file.
-*  @return - Whether the courses were successfully loaded.
-*/
-bool loadCourses(BinarySearchTree* bst, string csvPath) {
-    // This is the vector that stores all raw string lines from the csv file.
-    vector<string> csvLines;
+        return 1;
+#endif
+    }
 
-    // Check the format of the csv file before continuing.
-    if (!checkFileFormat(csvPath, csvLines)) {
-        cout << endl << "Incorrect file format." << endl;
+    if (selfTestRequested) {
+        return runSelfTest(loadOptions);
+    }
 
-        return false;
+    // If a csv file to generate or benchmark was given, do that instead of showing the menu.
+    if (!generatePath.empty()) {
+        return generateCatalog(generatePath, generatorOptions) ? 0 : 1;
+    }
+
+    if (!benchCatalogPath.empty()) {
+        return runBenchmark(benchCatalogPath, loadOptions);
     }
 
-    string courseElement;
-    int elementIndex;
-    int numberOfLoadedCourses = 0;
+    // If a socket was given, serve it or measure the server on it instead of showing the menu.
+    if (!serveSocketPath.empty() || !loadgenSocketPath.empty()) {
+#ifndef _WIN32
+        if (!loadgenSocketPath.empty()) {
+            if (batchQueriesPath.empty()) {
+                cout << "The load generator needs queries. Use --queries <query file>." << endl;
+
+                return 1;
+            }
 
-    // Parse through each line from the csv file.
-    for (string courseString : csvLines) {
-        // Create a new Course struct to add to the BST.
-        Course newCourse;
+            return runLoadGenerator(loadgenSocketPath, batchQueriesPath, connectionCount, pipelineDepth, requestCount);
+        }
 
-        // Open the current course string as a stream.
-        istringstream courseStringStream(courseString);
+        if (batchCatalogPath.empty()) {
+            cout << "The server needs a catalog. Use --catalog <csv file>." << endl;
 
-        elementIndex = 0;
+            return 1;
+        }
 
-        // Get each element from the current course string stream.
-        while (getline(courseStringStream, courseElement, ',')) {
-            // Update the new course struct with the course number from the current course element.
-            if (elementIndex == 0) {
-                // The letters in the course number should be uppercase for searching purposes.
-                newCourse.courseNumber = toUpperCase(courseElement);
-            }
+        // Load the catalog once for every client.
+        if (!publishCourses(catalogHandle, batchCatalogPath, loadOptions, false)) {
+            return 1;
+        }
 
-            // Update the new course struct with the course name from the current course element.
-            if (elementIndex == 1) {
-                newCourse.courseName = courseElement;
-            }
+        CourseServer server(catalogHandle);
 
-            // Append the current course element (prerequisite) to the new course struct's prerequisites vector.
-            if (elementIndex >= 2) {
-                // Skip empty strings or strings of whitespace.
-                if (!all_of(courseElement.begin(), courseElement.end(), isspace)) {
-                    newCourse.prerequisites.push_back(toUpperCase(courseElement));
-                }
-            }
+        if (!server.Listen(serveSocketPath)) {
+            cout << "Could not listen on " << serveSocketPath << "!" << endl;
 
-            elementIndex++;
+            return 1;
         }
 
-        // Insert the new course into the BST after processing the current line.
-        bst->Insert(newCourse);
+        // Each worker needs a reader slot, and the main thread already holds one.
+        workerCount = min(workerCount, CatalogHandle::maxReaders - 1);
 
-        // Update the number of courses that were loaded into the BST.
-        numberOfLoadedCourses++;
-    }
+        cout << "Serving " << serveSocketPath << " with " << workerCount << " workers." << endl;
 
-    // Print the number of courses that were loaded into the BST.
-    if (numberOfLoadedCourses == 1) {
-        cout << endl << numberOfLoadedCourses << " course was loaded." << endl;
-    }
-    else {
-        cout << endl << numberOfLoadedCourses << " courses were loaded." << endl;
+        server.Run(workerCount, batchCatalogPath, loadOptions);
+
+        cout << "Server stopped." << endl;
+
+        return 0;
+#else
+        cout << "The server and load generator need Unix domain sockets, which this build does not support." << endl;
+
+        return 1;
+#endif
     }
 
-    return true;
-}
+    // If a catalog was given, answer queries in batch mode instead of showing the menu.
+    if (!batchCatalogPath.empty()) {
+        // Standard input is only read through cin in batch mode.
+        ios::sync_with_stdio(false);
 
-/**
-* Convert all the letters in a given string to uppercase.
-* 
-* @param str - The string to make uppercase.
-*/
-string toUpperCase(string& str) {
-    // Loop through each character in the string and make it uppercase.
-    transform(str.begin(), str.end(), str.begin(), ::toupper);
+        // The load's messages go to standard error, so that standard output holds only the answers.
+        streambuf* answerBuffer = cout.rdbuf(cerr.rdbuf());
+        bool loaded = publishCourses(catalogHandle, batchCatalogPath, loadOptions, false);
 
-    return str;
-}
+        cout.rdbuf(answerBuffer);
 
-/**
- * The one and only main() method
- */
-int main(int argc, char* argv[]) {
-    // The path of the csv file of courses.
-    string csvPath;
+        if (!loaded) {
+            return 1;
+        }
 
-    // The course number to find and print.
-    string courseNumber;
+        ifstream queryFile;
 
-    // Define a binary search tree to hold all courses.
-    BinarySearchTree* bst;
+        // Read from standard input unless a query file was given.
+        if (!batchQueriesPath.empty() && batchQueriesPath != "-") {
+            queryFile.open(batchQueriesPath);
 
-    // Initialize the data structure used to store the courses.
-    bst = new BinarySearchTree();
+            if (!queryFile.is_open()) {
+                cout << endl << "Could not open file!" << endl;
 
-    // Define a boolean to determine if courses have been loaded yet.
-    bool coursesLoaded = false;
+                return 1;
+            }
+        }
 
-    // Define a boolean to determine if user input failed or not.
-    bool inputFailed = false;
-    
-    // Define a variable for the menu option. Set to 0 to enter program loop.
-    int choice = 0;
+        istream& queries = queryFile.is_open() ? static_cast<istream&>(queryFile) : cin;
+
+        // Collect every answer in one large buffer instead of flushing each line.
+        cout << flush;
+
+        BufferedWriter writer(stdout);
+        ostream out(&writer);
+
+        int failedQueries = runBatch(catalogHandle, readerSlot, queries, out);
+
+        out.flush();
+
+        return (failedQueries == 0) ? 0 : 1;
+    }
+    else if (!batchQueriesPath.empty()) {
+        cout << "Batch queries need a catalog. Use --catalog <csv file>." << endl;
+
+        return 1;
+    }
 
     // Print a greeting message.
     cout << "Welcome to the ABCU course planner!" << endl;
@@ -551,6 +10229,14 @@ int main(int argc, char* argv[]) {
         cout << "  1. Load Courses" << endl;
         cout << "  2. Display Courses" << endl;
         cout << "  3. Find Course" << endl;
+        cout << "  4. Reload Changed Courses" << endl;
+        cout << "  5. Find Courses in Range" << endl;
+        cout << "  6. Search Course Names" << endl;
+        cout << "  7. Find All Prerequisites" << endl;
+        cout << "  8. Display Study Order" << endl;
+        cout << "  10. Plan Semesters" << endl;
+        cout << "  11. Show Statistics" << endl;
+        cout << "  12. Reload Department" << endl;
         cout << "  9. Exit" << endl << endl;
 
         // Reset the input failed boolean.
@@ -574,7 +10260,7 @@ int main(int argc, char* argv[]) {
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
 
             // Print an error message because the user did not enter a correct option number.
-            cout << "Please enter an integer value of 1, 2, 3, or 9. " << endl;
+            cout << "Please enter an integer value of 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, or 12. " << endl;
         }
 
         switch (choice) {
@@ -584,20 +10270,19 @@ int main(int argc, char* argv[]) {
             cout << "Enter the system path and file name (Example: C:\\courses.csv): ";
             cin >> csvPath;
 
-            // Clear the BST before loading it with courses.
+            // Load all the courses from the specified csv file into a new BST and get whether it was successful or not.
             // This allows the user to load different files while the program is running.
-            bst->Clear();
-
-            // Load all the courses from the specified csv file and get whether it was successful or not.
-            coursesLoaded = loadCourses(bst, csvPath);
+            coursesLoaded = publishCourses(catalogHandle, csvPath, loadOptions, false);
 
             break;
 
         case 2:
             // If the user has successfully loaded courses via option 1...
             if (coursesLoaded) {
+                CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
                 // Print all courses.
-                bst->PrintSampleSchedule();
+                reader->PrintSampleSchedule();
             }
             else
             {
@@ -619,8 +10304,190 @@ int main(int argc, char* argv[]) {
                 // All course number letters are converted to uppercase before storing them in the BST.
                 toUpperCase(courseNumber);
 
+                CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
                 // Print the specified course number and its prerequisites if it is found.
-                bst->PrintCourseInformation(courseNumber);
+                reader->PrintCourseInformation(courseNumber);
+            }
+            else
+            {
+                // Print an error message if the user has not loaded courses yet.
+                cout << "Please load courses with Option 1 first." << endl;
+            }
+
+            break;
+
+        case 4:
+            // Ask the user for the csv file name and store it.
+            cout << "Enter the system path and file name (Example: C:\\courses.csv): ";
+            cin >> csvPath;
+
+            // If courses are loaded, apply only the lines that changed. Otherwise, load every course.
+            if (coursesLoaded) {
+                publishCourses(catalogHandle, csvPath, loadOptions, true);
+            }
+            else {
+                coursesLoaded = publishCourses(catalogHandle, csvPath, loadOptions, false);
+            }
+
+            break;
+
+        case 5:
+            // If the user has successfully loaded courses via option 1...
+            if (coursesLoaded) {
+                // Ask the user for the first course number, or a prefix, and store it.
+                cout << "Enter the first course number, or a prefix ending in * (Example: CSCI3*): ";
+                cin >> courseNumber;
+
+                // Convert the letters in the course number to uppercase before searching.
+                toUpperCase(courseNumber);
+
+                // If a prefix was entered, print every course that starts with it.
+                if (courseNumber.back() == '*') {
+                    courseNumber.pop_back();
+                    cout << endl;
+
+                    CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
+                    reader->PrintCoursesWithPrefix(courseNumber);
+                }
+                else {
+                    // Ask the user for the last course number and store it.
+                    cout << "Enter the last course number: ";
+                    cin >> lastCourseNumber;
+                    cout << endl;
+
+                    toUpperCase(lastCourseNumber);
+
+                    CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
+                    // Print every course from the first course number to the last.
+                    reader->PrintCoursesInRange(courseNumber, lastCourseNumber);
+                }
+            }
+            else
+            {
+                // Print an error message if the user has not loaded courses yet.
+                cout << "Please load courses with Option 1 first." << endl;
+            }
+
+            break;
+
+        case 6:
+            // If the user has successfully loaded courses via option 1...
+            if (coursesLoaded) {
+                // Ask the user for the words to search for and store them. The words may be separated by spaces.
+                cout << "Enter the words to search for (Example: data structures): ";
+                getline(cin, searchWords);
+                cout << endl;
+
+                CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
+                // Print every course whose name contains all of the words.
+                reader->PrintCoursesNamed(searchWords);
+            }
+            else
+            {
+                // Print an error message if the user has not loaded courses yet.
+                cout << "Please load courses with Option 1 first." << endl;
+            }
+
+            break;
+
+        case 7:
+            // If the user has successfully loaded courses via option 1...
+            if (coursesLoaded) {
+                // Ask the user for the course number and store it.
+                cout << "Enter the course number to find: ";
+                cin >> courseNumber;
+                cout << endl;
+
+                // Convert the letters in the course number to uppercase before searching.
+                toUpperCase(courseNumber);
+
+                CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
+                // Print the course and every course that must be taken before it.
+                reader->PrintAllPrerequisites(courseNumber);
+            }
+            else
+            {
+                // Print an error message if the user has not loaded courses yet.
+                cout << "Please load courses with Option 1 first." << endl;
+            }
+
+            break;
+
+        case 8:
+            // If the user has successfully loaded courses via option 1...
+            if (coursesLoaded) {
+                CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
+                // Print every course after all of its prerequisites.
+                reader->PrintStudyOrder();
+            }
+            else
+            {
+                // Print an error message if the user has not loaded courses yet.
+                cout << "Please load courses with Option 1 first." << endl;
+            }
+
+            break;
+
+        case 10:
+            // If the user has successfully loaded courses via option 1...
+            if (coursesLoaded) {
+                // Ask the user for the courses to plan for and store them. The course numbers may be separated by spaces.
+                cout << "Enter the course numbers to plan for (Example: CSCI300 CSCI400): ";
+                getline(cin, planCourseNumbers);
+
+                // Ask the user for the most courses per term and store it.
+                cout << "Enter the most courses per term: ";
+                cin >> termLimit;
+                cout << endl;
+
+                // If the user did not enter a positive integer...
+                if (cin.fail() || termLimit < 1) {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+                    // Print an error message because a plan needs at least one course per term.
+                    cout << "Please enter a positive integer for the courses per term." << endl;
+
+                    break;
+                }
+
+                // Convert the letters in the course numbers to uppercase before searching.
+                toUpperCase(planCourseNumbers);
+
+                CatalogHandle::ReadGuard reader(catalogHandle, readerSlot);
+
+                // Print the courses to take in each term.
+                reader->PrintPlan(planCourseNumbers, static_cast<size_t>(termLimit), planBuffers);
+            }
+            else
+            {
+                // Print an error message if the user has not loaded courses yet.
+                cout << "Please load courses with Option 1 first." << endl;
+            }
+
+            break;
+
+        case 11:
+            // Print the time spent loading and the cost of lookups so far.
+            printStats(cout);
+
+            break;
+
+        case 12:
+            // If the user has successfully loaded courses via option 1...
+            if (coursesLoaded) {
+                // Ask the user for the department's csv file name and store it.
+                cout << "Enter the system path and file name of the department (Example: C:\\csci.csv): ";
+                cin >> csvPath;
+
+                // Replace only the courses of the departments in the file.
+                publishDepartments(catalogHandle, csvPath, loadOptions);
             }
             else
             {
@@ -639,7 +10506,7 @@ int main(int argc, char* argv[]) {
             // If the input did not fail and the user entered an invalid integer...
             if (!inputFailed) {
                 // Print an error message if the user does not enter a correct option number.
-                cout << "Please enter an integer value of 1, 2, 3, or 9. " << endl;
+                cout << "Please enter an integer value of 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, or 12. " << endl;
             }
             
             break;
@@ -649,5 +10516,8 @@ int main(int argc, char* argv[]) {
     // Print a program end message after the user enters 9.
     cout << "Thank you for using the course planner! Goodbye." << endl;
 
+    // The catalog handle releases every course that is still loaded when it is destroyed.
+    catalogHandle.ReleaseReaderSlot(readerSlot);
+
 	return 0;
 }